@@ -0,0 +1,106 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+#endif
+#ifndef CRC32C_TARGET
+#define CRC32C_TARGET
+#endif
+
+constexpr uint32_t CRC32C_POLYNOMIAL = 0x82F63B78u;
+
+inline const uint32_t (&crc32cTables())[8][256] {
+    static uint32_t tables[8][256];
+    static bool initialized = [] {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (CRC32C_POLYNOMIAL & (0u - (crc & 1u)));
+            tables[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int t = 1; t < 8; ++t) tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+        }
+        return true;
+    }();
+    (void)initialized;
+    return tables;
+}
+
+inline uint32_t crc32cSoftware(const void* data, size_t length, uint32_t crc = 0) {
+    const uint32_t (&t)[8][256] = crc32cTables();
+    const unsigned char* p = (const unsigned char*)data;
+    crc = ~crc;
+    while (length >= 8) {
+        uint32_t lo;
+        uint32_t hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        p += 8;
+        length -= 8;
+    }
+    while (length-- > 0) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+    return ~crc;
+}
+
+#ifdef CRC32C_X86
+inline bool crc32cHardwareAvailable() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    return (ecx & bit_SSE4_2) != 0;
+#endif
+}
+
+CRC32C_TARGET inline uint32_t crc32cHardware(const void* data, size_t length, uint32_t crc = 0) {
+    const unsigned char* p = (const unsigned char*)data;
+    crc = ~crc;
+#if defined(_M_X64) || defined(__x86_64__)
+    uint64_t crc64 = crc;
+    while (length >= 8) {
+        uint64_t chunk;
+        memcpy(&chunk, p, 8);
+        crc64 = _mm_crc32_u64(crc64, chunk);
+        p += 8;
+        length -= 8;
+    }
+    crc = (uint32_t)crc64;
+#endif
+    while (length >= 4) {
+        uint32_t chunk;
+        memcpy(&chunk, p, 4);
+        crc = _mm_crc32_u32(crc, chunk);
+        p += 4;
+        length -= 4;
+    }
+    while (length-- > 0) crc = _mm_crc32_u8(crc, *p++);
+    return ~crc;
+}
+#endif
+
+inline uint32_t crc32c(const void* data, size_t length, uint32_t crc = 0) {
+#ifdef CRC32C_X86
+    static const bool hardware = crc32cHardwareAvailable();
+    if (hardware) return crc32cHardware(data, length, crc);
+#endif
+    return crc32cSoftware(data, length, crc);
+}
+
+#endif
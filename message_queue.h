@@ -8,17 +8,43 @@
 #include <vector>
 #include <windows.h>
 #include <filesystem>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <thread>
+#include <algorithm>
+#include "crc32c.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 constexpr int MAX_MESSAGE_LENGTH = 20;
+constexpr int DEFAULT_TIMER_CAPACITY = 1024;
+constexpr int TIMER_WHEEL_LEVELS = 4;
+constexpr int TIMER_WHEEL_BITS = 6;
+constexpr int TIMER_WHEEL_SLOTS = 1 << TIMER_WHEEL_BITS;
+constexpr int TIMER_NONE = -1;
+constexpr int MAX_TOPICS = 64;
+constexpr int TOPIC_NONE = -1;
+constexpr int QUEUE_FLAG_CHECKSUMS = 1;
+constexpr int SCRUB_PARALLEL_THRESHOLD = 4096;
+
+typedef unsigned long long TopicMask;
+constexpr TopicMask ALL_TOPICS = ~0ULL;
 
 #pragma pack(push, 1)
 struct Message {
     bool is_empty;
+    unsigned char topic;
     char text[MAX_MESSAGE_LENGTH];
-    Message() : is_empty(true) {
+    unsigned int correlation_id;
+    unsigned short reply_to;
+    unsigned char status;
+    unsigned int checksum;
+    Message() : is_empty(true), topic(0), correlation_id(0), reply_to(0), status(0), checksum(0) {
         memset(text, 0, sizeof(text));
     }
-    Message(const std::string& str) : is_empty(false) {
+    Message(const std::string& str, unsigned char topic = 0) : is_empty(false), topic(topic), correlation_id(0), reply_to(0), status(0), checksum(0) {
         strncpy(text, str.c_str(), MAX_MESSAGE_LENGTH - 1);
         text[MAX_MESSAGE_LENGTH - 1] = '\0';
     }
@@ -32,9 +58,56 @@ struct QueueHeader {
     int count;
     int head;
     int tail;
+    int timerCapacity;
+    int flags;
+    int corrupt;
+};
+
+struct TimerNode {
+    long long deadline;
+    int next;
+    Message message;
+};
+
+// Hierarchical timer wheel stored right after the message ring. Level L slot
+// covers 64^L ticks of 1 ms; occupied bitmaps let expiry jump over empty slots.
+struct TimerWheel {
+    long long currentTick;
+    long long nextDue;
+    long long wakeGeneration;
+    int pending;
+    int freeList;
+    int dueHead;
+    int dueTail;
+    unsigned long long occupied[TIMER_WHEEL_LEVELS];
+    int slotHead[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    int slotTail[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+};
+
+struct TopicIndex {
+    int first;
+    int last;
+    int pending;
+    long long written;
+    long long read;
+};
+
+// Per-topic FIFO lists threaded through the ring by producers, followed in the
+// file by one "next slot of the same topic" link per ring slot. Blocked filtered
+// readers OR their masks into wanted; a matching publish clears it and wakes them.
+struct TopicTable {
+    TopicMask nonEmpty;
+    TopicMask wanted;
+    TopicIndex topics[MAX_TOPICS];
 };
 #pragma pack(pop)
 
+struct TopicStats {
+    long long written;
+    long long read;
+    int pending;
+};
+
 class MessageQueue {
 private:
     std::string filename;
@@ -43,10 +116,19 @@ private:
     HANDLE hFileMap;
     QueueHeader* pMappedHeader;
     Message* pMappedMessages;
+    TimerWheel* pMappedWheel;
+    TimerNode* pMappedTimers;
+    TopicTable* pMappedTopics;
+    int* pMappedTopicLinks;
     HANDLE hSemEmpty;
     HANDLE hSemFull;
     HANDLE hMutex;
     HANDLE hReadyEvent;
+    HANDLE hTimerEvent;
+    HANDLE hPublishEvent;
+    int scrubErrors;
+    bool headerValid;
+    bool quietTimeouts;
     static std::string canonicalizePath(const std::string& p) {
         try {
             return std::filesystem::absolute(p).string();
@@ -62,21 +144,21 @@ private:
         }
         return std::string("Global\\") + name;
     }
-    bool createSyncObjects() {
+    bool createSyncObjects(int freeSlots, int readyMessages) {
         std::string base_name = filename;
         for (char& c : base_name) {
             if (c == ':' || c == '\\' || c == '/') c = '_';
         }
         std::string nameEmpty = getSyncObjectName(base_name, "empty");
         std::cout << "CreateSyncObjects: creating '" << nameEmpty << "'" << std::endl;
-        hSemEmpty = CreateSemaphoreA(NULL, header.capacity, header.capacity, nameEmpty.c_str());
+        hSemEmpty = CreateSemaphoreA(NULL, freeSlots, header.capacity, nameEmpty.c_str());
         if (hSemEmpty == NULL) {
             std::cerr << "CreateSemaphore empty failed: " << GetLastError() << std::endl;
             return false;
         }
         std::string nameFull = getSyncObjectName(base_name, "full");
         std::cout << "CreateSyncObjects: creating '" << nameFull << "'" << std::endl;
-        hSemFull = CreateSemaphoreA(NULL, 0, header.capacity, nameFull.c_str());
+        hSemFull = CreateSemaphoreA(NULL, readyMessages, header.capacity, nameFull.c_str());
         if (hSemFull == NULL) {
             std::cerr << "CreateSemaphore full failed: " << GetLastError() << std::endl;
             CloseHandle(hSemEmpty);
@@ -107,6 +189,22 @@ private:
             hMutex = NULL;
             return false;
         }
+        std::string nameTimer = getSyncObjectName(base_name, "timer");
+        std::cout << "CreateSyncObjects: creating '" << nameTimer << "'" << std::endl;
+        hTimerEvent = CreateEventA(NULL, TRUE, FALSE, nameTimer.c_str());
+        if (hTimerEvent == NULL) {
+            std::cerr << "CreateEvent timer failed: " << GetLastError() << std::endl;
+            closeSyncObjects();
+            return false;
+        }
+        std::string namePublish = getSyncObjectName(base_name, "publish");
+        std::cout << "CreateSyncObjects: creating '" << namePublish << "'" << std::endl;
+        hPublishEvent = CreateEventA(NULL, TRUE, FALSE, namePublish.c_str());
+        if (hPublishEvent == NULL) {
+            std::cerr << "CreateEvent publish failed: " << GetLastError() << std::endl;
+            closeSyncObjects();
+            return false;
+        }
         return true;
     }
     bool openSyncObjects() {
@@ -154,6 +252,22 @@ private:
             hMutex = NULL;
             return false;
         }
+        std::string nameTimer = getSyncObjectName(base_name, "timer");
+        std::cout << "OpenSyncObjects: opening '" << nameTimer << "'" << std::endl;
+        hTimerEvent = OpenEventA(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, nameTimer.c_str());
+        if (hTimerEvent == NULL) {
+            std::cerr << "OpenEvent timer failed: " << GetLastError() << std::endl;
+            closeSyncObjects();
+            return false;
+        }
+        std::string namePublish = getSyncObjectName(base_name, "publish");
+        std::cout << "OpenSyncObjects: opening '" << namePublish << "'" << std::endl;
+        hPublishEvent = OpenEventA(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, namePublish.c_str());
+        if (hPublishEvent == NULL) {
+            std::cerr << "OpenEvent publish failed: " << GetLastError() << std::endl;
+            closeSyncObjects();
+            return false;
+        }
         return true;
     }
     void closeSyncObjects() {
@@ -173,39 +287,158 @@ private:
             CloseHandle(hReadyEvent);
             hReadyEvent = NULL;
         }
+        if (hTimerEvent != NULL) {
+            CloseHandle(hTimerEvent);
+            hTimerEvent = NULL;
+        }
+        if (hPublishEvent != NULL) {
+            CloseHandle(hPublishEvent);
+            hPublishEvent = NULL;
+        }
     }
-
-public:
-    MessageQueue() : hFileMap(NULL), pMappedHeader(NULL), pMappedMessages(NULL), hSemEmpty(NULL), hSemFull(NULL), hMutex(NULL), hReadyEvent(NULL) {}
-    ~MessageQueue() {
-        if (pMappedHeader != NULL) {
-            UnmapViewOfFile(pMappedHeader);
-            pMappedHeader = NULL;
-            pMappedMessages = NULL;
+    void bindMappedRegions() {
+        pMappedMessages = (Message*)(pMappedHeader + 1);
+        pMappedWheel = (TimerWheel*)((char*)pMappedHeader + timerWheelOffset(header.capacity));
+        pMappedTimers = (TimerNode*)(pMappedWheel + 1);
+        pMappedTopics = (TopicTable*)(pMappedTimers + header.timerCapacity);
+        pMappedTopicLinks = (int*)(pMappedTopics + 1);
+    }
+    static long long currentTimeMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    static int lowestBit(unsigned long long bits) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return (int)index;
+#else
+        return __builtin_ctzll(bits);
+#endif
+    }
+    bool enqueueLocked(const Message& msg) {
+        int tail = pMappedHeader->tail;
+        if (!pMappedMessages[tail].is_empty) {
+            std::cerr << "ERROR: Cell at tail " << tail << " is not empty!" << std::endl;
+            return false;
         }
-        if (hFileMap != NULL) {
-            CloseHandle(hFileMap);
-            hFileMap = NULL;
+        pMappedMessages[tail] = msg;
+        pMappedHeader->tail = (tail + 1) % pMappedHeader->capacity;
+        pMappedHeader->count++;
+        linkTopic(tail, msg.topic);
+        if (pMappedTopics->wanted & (1ULL << msg.topic)) {
+            wakeTopicReadersLocked();
         }
-        closeSyncObjects();
+        return true;
     }
-    bool create(const std::string& fname, int capacity) {
-        filename = canonicalizePath(fname);
-        header = { capacity, 0, 0, 0 };
-        std::cout << "Creating queue file: " << filename << " with capacity: " << capacity << std::endl;
-        HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    void wakeTopicReadersLocked() {
+        pMappedTopics->wanted = 0;
+        if (!SetEvent(hPublishEvent)) {
+            std::cerr << "Failed to signal publish event: " << GetLastError() << std::endl;
+        }
+    }
+    void linkTopic(int slot, unsigned char topic) {
+        TopicIndex& index = pMappedTopics->topics[topic];
+        pMappedTopicLinks[slot] = TOPIC_NONE;
+        if (index.last == TOPIC_NONE) index.first = slot;
+        else pMappedTopicLinks[index.last] = slot;
+        index.last = slot;
+        index.pending++;
+        index.written++;
+        pMappedTopics->nonEmpty |= 1ULL << topic;
+    }
+    int findFirstMatchLocked(TopicMask topics) const {
+        TopicMask candidates = topics & pMappedTopics->nonEmpty;
+        int capacity = pMappedHeader->capacity;
+        int best = TOPIC_NONE;
+        int bestDistance = capacity;
+        while (candidates != 0) {
+            int topic = lowestBit(candidates);
+            candidates &= candidates - 1;
+            int slot = pMappedTopics->topics[topic].first;
+            int distance = (slot - pMappedHeader->head + capacity) % capacity;
+            if (distance < bestDistance) {
+                best = slot;
+                bestDistance = distance;
+            }
+        }
+        return best;
+    }
+    int unlinkTopicLocked(int slot, unsigned char hint) {
+        int topic = TOPIC_NONE;
+        if (hint < MAX_TOPICS && pMappedTopics->topics[hint].first == slot) topic = hint;
+        TopicMask candidates = pMappedTopics->nonEmpty;
+        while (topic == TOPIC_NONE && candidates != 0) {
+            int candidate = lowestBit(candidates);
+            candidates &= candidates - 1;
+            if (pMappedTopics->topics[candidate].first == slot) topic = candidate;
+        }
+        if (topic == TOPIC_NONE) {
+            std::cerr << "Slot " << slot << " is not at the front of any topic list" << std::endl;
+            return TOPIC_NONE;
+        }
+        TopicIndex& index = pMappedTopics->topics[topic];
+        index.first = pMappedTopicLinks[slot];
+        pMappedTopicLinks[slot] = TOPIC_NONE;
+        if (index.first == TOPIC_NONE) index.last = TOPIC_NONE;
+        index.pending--;
+        index.read++;
+        if (index.pending <= 0) pMappedTopics->nonEmpty &= ~(1ULL << topic);
+        return topic;
+    }
+    void releaseConsumedSlotsLocked() {
+        int freed = 0;
+        while (pMappedHeader->count > 0 && isTombstone(pMappedMessages[pMappedHeader->head])) {
+            pMappedHeader->head = (pMappedHeader->head + 1) % pMappedHeader->capacity;
+            pMappedHeader->count--;
+            freed++;
+        }
+        if (freed > 0 && !ReleaseSemaphore(hSemEmpty, freed, NULL)) {
+            std::cerr << "Failed to release empty semaphore: " << GetLastError() << std::endl;
+        }
+    }
+    Message takeLocked(int slot) {
+        Message msg = pMappedMessages[slot];
+        bool intact = !msg.is_empty && msg.topic < MAX_TOPICS && checksumOk(msg);
+        unlinkTopicLocked(slot, msg.topic);
+        pMappedMessages[slot] = Message();
+        releaseConsumedSlotsLocked();
+        if (pMappedWheel->dueHead != TIMER_NONE) {
+            promoteDueTimers();
+        }
+        if (!intact) {
+            pMappedHeader->corrupt++;
+            std::cerr << "Checksum mismatch, dropped corrupted message from position " << slot << std::endl;
+            return Message();
+        }
+        return msg;
+    }
+    static unsigned int messageChecksum(const Message& msg) {
+        return crc32c(&msg, offsetof(Message, checksum));
+    }
+    Message stampChecksum(const Message& msg) const {
+        Message stamped = msg;
+        if (pMappedHeader->flags & QUEUE_FLAG_CHECKSUMS) {
+            stamped.checksum = messageChecksum(stamped);
+        }
+        return stamped;
+    }
+    bool checksumOk(const Message& msg) const {
+        return !(pMappedHeader->flags & QUEUE_FLAG_CHECKSUMS) || msg.checksum == messageChecksum(msg);
+    }
+    bool formatFile(DWORD disposition, bool named) {
+        HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, disposition, FILE_ATTRIBUTE_NORMAL, NULL);
         if (hFile == INVALID_HANDLE_VALUE) {
             std::cerr << "CreateFile failed: " << GetLastError() << std::endl;
             return false;
         }
         LARGE_INTEGER fileSize;
-        fileSize.QuadPart = sizeof(QueueHeader) + capacity * sizeof(Message);
+        fileSize.QuadPart = queueFileSize(header.capacity, header.timerCapacity);
         SetFilePointerEx(hFile, fileSize, NULL, FILE_BEGIN);
         SetEndOfFile(hFile);
         std::string base_name = filename;
         for (char& c : base_name) if (c == ':' || c == '\\' || c == '/') c = '_';
-        mappingName = std::string("Global\\mq_map_") + base_name;
-        hFileMap = CreateFileMappingA(hFile, NULL, PAGE_READWRITE, 0, 0, mappingName.c_str());
+        mappingName = named ? std::string("Global\\mq_map_") + base_name : std::string();
+        hFileMap = CreateFileMappingA(hFile, NULL, PAGE_READWRITE, 0, 0, named ? mappingName.c_str() : NULL);
         CloseHandle(hFile);
         if (hFileMap == NULL) {
             std::cerr << "CreateFileMapping failed: " << GetLastError() << std::endl;
@@ -219,48 +452,566 @@ public:
             return false;
         }
         *pMappedHeader = header;
-        pMappedMessages = (Message*)(pMappedHeader + 1);
-        for (int i = 0; i < capacity; ++i) {
+        bindMappedRegions();
+        for (int i = 0; i < header.capacity; ++i) {
             pMappedMessages[i] = Message();
         }
-        if (!createSyncObjects()) {
-            std::cerr << "Failed to create synchronization objects" << std::endl;
-            return false;
-        }
-        std::cout << "Queue created successfully" << std::endl;
+        initTimerWheel(header.timerCapacity);
+        initTopicTable(header.capacity);
         return true;
     }
-    bool open(const std::string& fname) {
-        filename = canonicalizePath(fname);
-        std::cout << "Opening queue file: " << filename << std::endl;
-        HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    bool mapExistingFile(bool readOnly) {
+        HANDLE hFile = CreateFileA(filename.c_str(), readOnly ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
         if (hFile == INVALID_HANDLE_VALUE) {
             std::cerr << "CreateFile failed: " << GetLastError() << std::endl;
             return false;
         }
         std::string base_name = filename;
         for (char& c : base_name) if (c == ':' || c == '\\' || c == '/') c = '_';
-        mappingName = std::string("Global\\mq_map_") + base_name;
-        hFileMap = CreateFileMappingA(hFile, NULL, PAGE_READWRITE, 0, 0, mappingName.c_str());
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(hFile, &fileSize)) {
+            std::cerr << "GetFileSizeEx failed: " << GetLastError() << std::endl;
+            CloseHandle(hFile);
+            return false;
+        }
+        mappingName = readOnly ? std::string() : std::string("Global\\mq_map_") + base_name;
+        hFileMap = CreateFileMappingA(hFile, NULL, readOnly ? PAGE_READONLY : PAGE_READWRITE, 0, 0, readOnly ? NULL : mappingName.c_str());
         CloseHandle(hFile);
         if (hFileMap == NULL) {
             std::cerr << "CreateFileMapping failed: " << GetLastError() << std::endl;
             return false;
         }
-        pMappedHeader = (QueueHeader*)MapViewOfFile(hFileMap, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+        pMappedHeader = (QueueHeader*)MapViewOfFile(hFileMap, readOnly ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS, 0, 0, 0);
         if (pMappedHeader == NULL) {
             std::cerr << "MapViewOfFile failed: " << GetLastError() << std::endl;
             CloseHandle(hFileMap);
             hFileMap = NULL;
             return false;
         }
-        pMappedMessages = (Message*)(pMappedHeader + 1);
+        headerValid = validateHeader(fileSize.QuadPart);
+        if (!headerValid && (!readOnly || fileSize.QuadPart < (long long)sizeof(QueueHeader))) {
+            UnmapViewOfFile(pMappedHeader);
+            pMappedHeader = NULL;
+            CloseHandle(hFileMap);
+            hFileMap = NULL;
+            return false;
+        }
         header = *pMappedHeader;
-        std::cout << "Queue info - capacity: " << pMappedHeader->capacity << ", count: " << pMappedHeader->count << ", head: " << pMappedHeader->head << ", tail: " << pMappedHeader->tail << std::endl;
+        if (!headerValid) {
+            clampDamagedHeader(fileSize.QuadPart);
+            return true;
+        }
+        bindMappedRegions();
+        return true;
+    }
+    void clampDamagedHeader(long long fileSize) {
+        const QueueHeader& h = *pMappedHeader;
+        long long fits = (fileSize - (long long)sizeof(QueueHeader)) / (long long)sizeof(Message);
+        bool layoutOk = h.capacity > 0 && h.timerCapacity >= 0 && (long long)queueFileSize(h.capacity, h.timerCapacity) == fileSize;
+        header.capacity = h.capacity < 0 ? 0 : (h.capacity > fits ? (int)fits : h.capacity);
+        long long fixedSize = h.timerCapacity >= 0 ? (long long)queueFileSize(0, h.timerCapacity) : fileSize;
+        long long slotSize = (long long)(sizeof(Message) + sizeof(int));
+        if (!layoutOk && fileSize > fixedSize && (fileSize - fixedSize) % slotSize == 0) {
+            header.capacity = (int)((fileSize - fixedSize) / slotSize);
+            layoutOk = true;
+        }
+        header.head = h.head >= 0 && h.head < header.capacity ? h.head : 0;
+        header.count = h.count < 0 ? 0 : (h.count > header.capacity ? header.capacity : h.count);
+        if (h.tail >= 0 && h.tail < header.capacity) {
+            int span = (h.tail - header.head + header.capacity) % header.capacity;
+            if (span > header.count) header.count = span;
+        }
+        header.tail = header.capacity > 0 ? (header.head + header.count) % header.capacity : 0;
+        pMappedMessages = (Message*)(pMappedHeader + 1);
+        if (layoutOk) bindMappedRegions();
+        std::cerr << "Warning: inconsistent queue header, showing " << header.count << " slots starting at slot " << header.head << std::endl;
+    }
+    bool verifyStructures() {
+        DWORD waitResult = WaitForSingleObject(hMutex, INFINITE);
+        if (waitResult == WAIT_ABANDONED) {
+            std::cerr << "Queue mutex was abandoned by a crashed process, verifying queue structures" << std::endl;
+        }
+        else if (waitResult != WAIT_OBJECT_0) {
+            std::cerr << "Failed to wait for mutex: " << GetLastError() << std::endl;
+            return false;
+        }
+        repairStructuresLocked();
+        ReleaseMutex(hMutex);
+        return true;
+    }
+    DWORD lockQueue(DWORD timeout) {
+        DWORD waitResult = WaitForSingleObject(hMutex, timeout);
+        if (waitResult == WAIT_ABANDONED) {
+            std::cerr << "Queue mutex was abandoned by a crashed process, repairing queue structures" << std::endl;
+            repairStructuresLocked();
+            waitResult = WAIT_OBJECT_0;
+        }
+        return waitResult;
+    }
+    void repairStructuresLocked() {
+        scrubErrors = 0;
+        if (pMappedHeader->flags & QUEUE_FLAG_CHECKSUMS) {
+            scrubErrors = scrubRecords();
+            std::cout << "Scrub finished - corrupted records: " << scrubErrors << std::endl;
+        }
+        if (!rebuildTopicIndex()) {
+            std::cerr << "Topic index was inconsistent and has been rebuilt from the ring" << std::endl;
+            scrubErrors++;
+        }
+        if (!timerWheelConsistent()) {
+            std::cerr << "Timer wheel was inconsistent and has been rebuilt from the timer nodes" << std::endl;
+            rebuildTimerWheel();
+            scrubErrors++;
+        }
+        FlushViewOfFile(pMappedHeader, 0);
+    }
+    static bool isTombstone(const Message& msg) {
+        static const Message tombstone;
+        return memcmp(&msg, &tombstone, sizeof(Message)) == 0;
+    }
+    int walkTimerList(int node, std::vector<bool>& seen, int& last) const {
+        int length = 0;
+        last = TIMER_NONE;
+        while (node != TIMER_NONE) {
+            if (node < 0 || node >= pMappedHeader->timerCapacity || seen[node]) return -1;
+            seen[node] = true;
+            last = node;
+            length++;
+            node = pMappedTimers[node].next;
+        }
+        return length;
+    }
+    bool timerWheelConsistent() const {
+        const TimerWheel* w = pMappedWheel;
+        std::vector<bool> seen(pMappedHeader->timerCapacity, false);
+        int last;
+        int freeCount = walkTimerList(w->freeList, seen, last);
+        int due = walkTimerList(w->dueHead, seen, last);
+        if (freeCount < 0 || due < 0 || last != w->dueTail) return false;
+        int scheduled = due;
+        for (int level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+            for (int slot = 0; slot < TIMER_WHEEL_SLOTS; ++slot) {
+                int length = walkTimerList(w->slotHead[level][slot], seen, last);
+                bool occupied = (w->occupied[level] & (1ULL << slot)) != 0;
+                if (length < 0 || last != w->slotTail[level][slot] || occupied != (length > 0)) return false;
+                scheduled += length;
+            }
+        }
+        return scheduled == w->pending && freeCount + scheduled == pMappedHeader->timerCapacity;
+    }
+    void rebuildTimerWheel() {
+        TimerWheel* w = pMappedWheel;
+        int timerCapacity = pMappedHeader->timerCapacity;
+        w->currentTick = currentTimeMs();
+        w->pending = 0;
+        w->freeList = TIMER_NONE;
+        w->dueHead = TIMER_NONE;
+        w->dueTail = TIMER_NONE;
+        for (int level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+            w->occupied[level] = 0;
+            for (int slot = 0; slot < TIMER_WHEEL_SLOTS; ++slot) {
+                w->slotHead[level][slot] = TIMER_NONE;
+                w->slotTail[level][slot] = TIMER_NONE;
+            }
+        }
+        for (int node = timerCapacity - 1; node >= 0; --node) {
+            if (!pMappedTimers[node].message.is_empty) continue;
+            pMappedTimers[node].next = w->freeList;
+            w->freeList = node;
+        }
+        for (int node = 0; node < timerCapacity; ++node) {
+            if (pMappedTimers[node].message.is_empty) continue;
+            w->pending++;
+            scheduleTimer(node);
+        }
+        w->nextDue = nextTimerEvent();
+    }
+    bool rebuildTopicIndex() {
+        int capacity = pMappedHeader->capacity;
+        std::vector<int> links(capacity, TOPIC_NONE);
+        TopicIndex topics[MAX_TOPICS];
+        TopicMask nonEmpty = 0;
+        for (int topic = 0; topic < MAX_TOPICS; ++topic) {
+            topics[topic] = { TOPIC_NONE, TOPIC_NONE, 0, pMappedTopics->topics[topic].written, pMappedTopics->topics[topic].read };
+        }
+        for (int i = 0; i < pMappedHeader->count; ++i) {
+            int slot = (pMappedHeader->head + i) % capacity;
+            const Message& msg = pMappedMessages[slot];
+            if (msg.is_empty || msg.topic >= MAX_TOPICS) continue;
+            TopicIndex& index = topics[msg.topic];
+            if (index.last == TOPIC_NONE) index.first = slot;
+            else links[index.last] = slot;
+            index.last = slot;
+            index.pending++;
+            nonEmpty |= 1ULL << msg.topic;
+        }
+        bool consistent = nonEmpty == pMappedTopics->nonEmpty && memcmp(links.data(), pMappedTopicLinks, (size_t)capacity * sizeof(int)) == 0;
+        for (int topic = 0; topic < MAX_TOPICS && consistent; ++topic) {
+            const TopicIndex& mapped = pMappedTopics->topics[topic];
+            consistent = mapped.first == topics[topic].first && mapped.last == topics[topic].last && mapped.pending == topics[topic].pending;
+        }
+        if (consistent) return true;
+        pMappedTopics->nonEmpty = nonEmpty;
+        memcpy(pMappedTopics->topics, topics, sizeof(topics));
+        memcpy(pMappedTopicLinks, links.data(), (size_t)capacity * sizeof(int));
+        return false;
+    }
+    bool validateHeader(long long fileSize) const {
+        if (fileSize < (long long)sizeof(QueueHeader)) {
+            std::cerr << "Queue file too small: " << fileSize << " bytes" << std::endl;
+            return false;
+        }
+        const QueueHeader& h = *pMappedHeader;
+        if (h.capacity <= 0 || h.timerCapacity < 0 || (long long)queueFileSize(h.capacity, h.timerCapacity) != fileSize) {
+            std::cerr << "Corrupted queue header - capacity: " << h.capacity << ", timer capacity: " << h.timerCapacity << ", file size: " << fileSize << std::endl;
+            return false;
+        }
+        if (h.head < 0 || h.head >= h.capacity || h.tail < 0 || h.tail >= h.capacity || h.count < 0 || h.count > h.capacity || (h.head + h.count) % h.capacity != h.tail) {
+            std::cerr << "Corrupted queue header - count: " << h.count << ", head: " << h.head << ", tail: " << h.tail << std::endl;
+            return false;
+        }
+        return true;
+    }
+    int scrubRange(int first, int last) {
+        int bad = 0;
+        for (int i = first; i < last; ++i) {
+            int slot = (pMappedHeader->head + i) % pMappedHeader->capacity;
+            Message& msg = pMappedMessages[slot];
+            if (msg.is_empty) {
+                if (i > 0 && isTombstone(msg)) continue;
+                std::cerr << "Damaged empty record in slot " << slot << std::endl;
+                bad++;
+                if (!isTombstone(msg)) msg.is_empty = false;
+            }
+            else if (msg.checksum != messageChecksum(msg)) {
+                std::cerr << "Checksum mismatch in slot " << slot << std::endl;
+                bad++;
+            }
+        }
+        return bad;
+    }
+    int scrubRecords() {
+        int count = pMappedHeader->count;
+        int workers = 1;
+        if (count >= SCRUB_PARALLEL_THRESHOLD) {
+            workers = (int)std::thread::hardware_concurrency();
+            if (workers < 1) workers = 1;
+        }
+        std::vector<int> bad(workers, 0);
+        std::vector<std::thread> threads;
+        int chunk = (count + workers - 1) / workers;
+        for (int w = 1; w < workers; ++w) {
+            int first = w * chunk < count ? w * chunk : count;
+            int last = first + chunk < count ? first + chunk : count;
+            threads.emplace_back([this, &bad, w, first, last] { bad[w] = scrubRange(first, last); });
+        }
+        bad[0] = scrubRange(0, chunk < count ? chunk : count);
+        for (std::thread& t : threads) t.join();
+        int total = 0;
+        for (int b : bad) total += b;
+        for (int node = 0; node < pMappedHeader->timerCapacity; ++node) {
+            const Message& msg = pMappedTimers[node].message;
+            if (!msg.is_empty && msg.checksum != messageChecksum(msg)) {
+                std::cerr << "Checksum mismatch in timer " << node << std::endl;
+                total++;
+            }
+        }
+        return total;
+    }
+    void initTopicTable(int capacity) {
+        pMappedTopics->nonEmpty = 0;
+        pMappedTopics->wanted = 0;
+        for (int topic = 0; topic < MAX_TOPICS; ++topic) {
+            pMappedTopics->topics[topic] = { TOPIC_NONE, TOPIC_NONE, 0, 0, 0 };
+        }
+        for (int i = 0; i < capacity; ++i) {
+            pMappedTopicLinks[i] = TOPIC_NONE;
+        }
+    }
+    void initTimerWheel(int timerCapacity) {
+        TimerWheel* w = pMappedWheel;
+        w->currentTick = currentTimeMs();
+        w->nextDue = LLONG_MAX;
+        w->wakeGeneration = 0;
+        w->pending = 0;
+        w->freeList = timerCapacity > 0 ? 0 : TIMER_NONE;
+        w->dueHead = TIMER_NONE;
+        w->dueTail = TIMER_NONE;
+        for (int level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+            w->occupied[level] = 0;
+            for (int slot = 0; slot < TIMER_WHEEL_SLOTS; ++slot) {
+                w->slotHead[level][slot] = TIMER_NONE;
+                w->slotTail[level][slot] = TIMER_NONE;
+            }
+        }
+        for (int i = 0; i < timerCapacity; ++i) {
+            pMappedTimers[i].deadline = 0;
+            pMappedTimers[i].next = i + 1 < timerCapacity ? i + 1 : TIMER_NONE;
+            pMappedTimers[i].message = Message();
+        }
+    }
+    long long nextTimerEvent() const {
+        const TimerWheel* w = pMappedWheel;
+        long long best = LLONG_MAX;
+        for (int level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+            unsigned long long bits = w->occupied[level];
+            if (bits == 0) continue;
+            int shift = level * TIMER_WHEEL_BITS;
+            long long base = w->currentTick >> shift;
+            int cur = (int)(base & (TIMER_WHEEL_SLOTS - 1));
+            unsigned long long ahead = cur == TIMER_WHEEL_SLOTS - 1 ? 0 : bits & (~0ULL << (cur + 1));
+            long long index = ahead != 0 ? base - cur + lowestBit(ahead) : base - cur + TIMER_WHEEL_SLOTS + lowestBit(bits);
+            long long tick = index << shift;
+            if (tick < best) best = tick;
+        }
+        return best;
+    }
+    void scheduleTimer(int node) {
+        TimerWheel* w = pMappedWheel;
+        TimerNode& timer = pMappedTimers[node];
+        timer.next = TIMER_NONE;
+        long long delta = timer.deadline - w->currentTick;
+        if (delta <= 0) {
+            if (w->dueTail == TIMER_NONE) w->dueHead = node;
+            else pMappedTimers[w->dueTail].next = node;
+            w->dueTail = node;
+            return;
+        }
+        int level = 0;
+        while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1LL << ((level + 1) * TIMER_WHEEL_BITS))) ++level;
+        long long span = 1LL << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS);
+        long long placed = delta < span ? timer.deadline : w->currentTick + span - 1;
+        int slot = (int)((placed >> (level * TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SLOTS - 1));
+        if (w->slotTail[level][slot] == TIMER_NONE) w->slotHead[level][slot] = node;
+        else pMappedTimers[w->slotTail[level][slot]].next = node;
+        w->slotTail[level][slot] = node;
+        w->occupied[level] |= 1ULL << slot;
+    }
+    void promoteDueTimers() {
+        TimerWheel* w = pMappedWheel;
+        while (w->dueHead != TIMER_NONE) {
+            if (WaitForSingleObject(hSemEmpty, 0) != WAIT_OBJECT_0) break;
+            int node = w->dueHead;
+            if (!enqueueLocked(pMappedTimers[node].message)) {
+                ReleaseSemaphore(hSemEmpty, 1, NULL);
+                break;
+            }
+            w->dueHead = pMappedTimers[node].next;
+            if (w->dueHead == TIMER_NONE) w->dueTail = TIMER_NONE;
+            pMappedTimers[node].message = Message();
+            pMappedTimers[node].next = w->freeList;
+            w->freeList = node;
+            w->pending--;
+            if (!ReleaseSemaphore(hSemFull, 1, NULL)) {
+                std::cerr << "Failed to release full semaphore: " << GetLastError() << std::endl;
+            }
+        }
+    }
+    void advanceTimers(long long now) {
+        TimerWheel* w = pMappedWheel;
+        while (true) {
+            long long tick = nextTimerEvent();
+            if (tick > now) break;
+            w->currentTick = tick;
+            for (int level = TIMER_WHEEL_LEVELS - 1; level >= 0; --level) {
+                int shift = level * TIMER_WHEEL_BITS;
+                if ((tick & ((1LL << shift) - 1)) != 0) continue;
+                int slot = (int)((tick >> shift) & (TIMER_WHEEL_SLOTS - 1));
+                if ((w->occupied[level] & (1ULL << slot)) == 0) continue;
+                int node = w->slotHead[level][slot];
+                w->slotHead[level][slot] = TIMER_NONE;
+                w->slotTail[level][slot] = TIMER_NONE;
+                w->occupied[level] &= ~(1ULL << slot);
+                while (node != TIMER_NONE) {
+                    int next = pMappedTimers[node].next;
+                    scheduleTimer(node);
+                    node = next;
+                }
+            }
+        }
+        if (now > w->currentTick) w->currentTick = now;
+        w->nextDue = nextTimerEvent();
+        promoteDueTimers();
+    }
+    DWORD pumpTimers() {
+        if (pMappedWheel->pending == 0) return INFINITE;
+        long long now = currentTimeMs();
+        if (now >= pMappedWheel->nextDue) {
+            if (lockQueue(INFINITE) != WAIT_OBJECT_0) {
+                std::cerr << "Failed to wait for mutex: " << GetLastError() << std::endl;
+                return INFINITE;
+            }
+            advanceTimers(now);
+            ReleaseMutex(hMutex);
+        }
+        long long nextDue = pMappedWheel->nextDue;
+        if (nextDue == LLONG_MAX) return INFINITE;
+        now = currentTimeMs();
+        if (nextDue <= now) return 0;
+        return (unsigned long long)(nextDue - now) >= INFINITE ? INFINITE - 1 : (DWORD)(nextDue - now);
+    }
+    long long timerGeneration() const {
+        return *(volatile const long long*)&pMappedWheel->wakeGeneration;
+    }
+    DWORD waitForMessage(DWORD timeout) {
+        HANDLE handles[2] = { hSemFull, hTimerEvent };
+        ULONGLONG start = GetTickCount64();
+        while (true) {
+            long long generation = timerGeneration();
+            DWORD untilDue = pumpTimers();
+            DWORD remaining = timeout;
+            if (timeout != INFINITE) {
+                ULONGLONG elapsed = GetTickCount64() - start;
+                remaining = elapsed >= timeout ? 0 : (DWORD)(timeout - elapsed);
+            }
+            DWORD slice = untilDue < remaining ? untilDue : remaining;
+            if (timerGeneration() != generation) continue;
+            DWORD result = WaitForMultipleObjects(2, handles, FALSE, slice);
+            if (result == WAIT_OBJECT_0) return result;
+            if (result == WAIT_OBJECT_0 + 1) {
+                ResetEvent(hTimerEvent);
+                continue;
+            }
+            if (result != WAIT_TIMEOUT) return result;
+            if (slice == remaining && remaining < untilDue) {
+                pumpTimers();
+                return WaitForSingleObject(hSemFull, 0);
+            }
+        }
+    }
+
+public:
+    MessageQueue() : hFileMap(NULL), pMappedHeader(NULL), pMappedMessages(NULL), pMappedWheel(NULL), pMappedTimers(NULL), pMappedTopics(NULL), pMappedTopicLinks(NULL), hSemEmpty(NULL), hSemFull(NULL), hMutex(NULL), hReadyEvent(NULL), hTimerEvent(NULL), hPublishEvent(NULL), scrubErrors(0), headerValid(true), quietTimeouts(false) {}
+    ~MessageQueue() {
+        close();
+    }
+    void close() {
+        if (pMappedHeader != NULL) {
+            UnmapViewOfFile(pMappedHeader);
+            pMappedHeader = NULL;
+            pMappedMessages = NULL;
+            pMappedWheel = NULL;
+            pMappedTimers = NULL;
+            pMappedTopics = NULL;
+            pMappedTopicLinks = NULL;
+        }
+        if (hFileMap != NULL) {
+            CloseHandle(hFileMap);
+            hFileMap = NULL;
+        }
+        closeSyncObjects();
+        headerValid = true;
+    }
+    static size_t timerWheelOffset(int capacity) {
+        return sizeof(QueueHeader) + (size_t)capacity * sizeof(Message);
+    }
+    static size_t queueFileSize(int capacity, int timerCapacity) {
+        return timerWheelOffset(capacity) + sizeof(TimerWheel) + (size_t)timerCapacity * sizeof(TimerNode) + sizeof(TopicTable) + (size_t)capacity * sizeof(int);
+    }
+    bool create(const std::string& fname, int capacity, int timerCapacity = DEFAULT_TIMER_CAPACITY, int flags = 0) {
+        if (timerCapacity < 0) {
+            std::cerr << "Invalid timer capacity: " << timerCapacity << std::endl;
+            return false;
+        }
+        filename = canonicalizePath(fname);
+        header = { capacity, 0, 0, 0, timerCapacity, flags, 0 };
+        std::cout << "Creating queue file: " << filename << " with capacity: " << capacity << ", timer capacity: " << timerCapacity << std::endl;
+        if (!formatFile(CREATE_ALWAYS, true)) {
+            return false;
+        }
+        if (!createSyncObjects(capacity, 0)) {
+            std::cerr << "Failed to create synchronization objects" << std::endl;
+            return false;
+        }
+        std::cout << "Queue created successfully" << std::endl;
+        return true;
+    }
+    bool open(const std::string& fname) {
+        filename = canonicalizePath(fname);
+        std::cout << "Opening queue file: " << filename << std::endl;
+        if (!mapExistingFile(false)) {
+            return false;
+        }
+        std::cout << "Queue info - capacity: " << pMappedHeader->capacity << ", count: " << pMappedHeader->count << ", head: " << pMappedHeader->head << ", tail: " << pMappedHeader->tail << ", pending timers: " << pMappedWheel->pending << std::endl;
         if (!openSyncObjects()) {
             std::cerr << "Failed to open synchronization objects" << std::endl;
             return false;
         }
+        return verifyStructures();
+    }
+    bool attach(const std::string& fname) {
+        filename = canonicalizePath(fname);
+        std::cout << "Attaching to queue file: " << filename << std::endl;
+        if (!mapExistingFile(false)) {
+            return false;
+        }
+        if (!createSyncObjects(0, 0)) {
+            std::cerr << "Failed to create synchronization objects" << std::endl;
+            return false;
+        }
+        if (GetLastError() == ERROR_ALREADY_EXISTS) {
+            std::cerr << "Queue " << filename << " is already in use, use open() instead" << std::endl;
+            closeSyncObjects();
+            return false;
+        }
+        if (!verifyStructures()) {
+            return false;
+        }
+        int ready = 0;
+        for (int i = 0; i < pMappedHeader->count; ++i) {
+            if (!pMappedMessages[(pMappedHeader->head + i) % pMappedHeader->capacity].is_empty) ready++;
+        }
+        int freeSlots = pMappedHeader->capacity - pMappedHeader->count;
+        std::cout << "Queue info - capacity: " << pMappedHeader->capacity << ", count: " << pMappedHeader->count << ", ready: " << ready << ", pending timers: " << pMappedWheel->pending << std::endl;
+        if ((freeSlots > 0 && !ReleaseSemaphore(hSemEmpty, freeSlots, NULL)) || (ready > 0 && !ReleaseSemaphore(hSemFull, ready, NULL))) {
+            std::cerr << "Failed to initialize semaphores: " << GetLastError() << std::endl;
+            return false;
+        }
+        return true;
+    }
+    bool openReadOnly(const std::string& fname) {
+        filename = canonicalizePath(fname);
+        return mapExistingFile(true);
+    }
+    bool importFile(const std::string& fname, const Message* records, int count, int capacity, int timerCapacity, int flags, const TimerNode* timers = NULL, int timerCount = 0) {
+        if (count < 0 || capacity <= 0 || count > capacity || timerCapacity < 0 || timerCount < 0 || timerCount > timerCapacity) {
+            std::cerr << "Invalid import - records: " << count << ", capacity: " << capacity << ", timers: " << timerCount << ", timer capacity: " << timerCapacity << std::endl;
+            return false;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (records[i].is_empty || records[i].topic >= MAX_TOPICS) {
+                std::cerr << "Invalid record " << i << " in import, topic: " << (int)records[i].topic << std::endl;
+                return false;
+            }
+        }
+        for (int i = 0; i < timerCount; ++i) {
+            if (timers[i].message.is_empty || timers[i].message.topic >= MAX_TOPICS) {
+                std::cerr << "Invalid timer " << i << " in import, topic: " << (int)timers[i].message.topic << std::endl;
+                return false;
+            }
+        }
+        filename = canonicalizePath(fname);
+        header = { capacity, 0, 0, 0, timerCapacity, flags, 0 };
+        if (!formatFile(CREATE_NEW, false)) {
+            return false;
+        }
+        if (count > 0) {
+            memcpy(pMappedMessages, records, (size_t)count * sizeof(Message));
+        }
+        for (int i = 0; i < count; ++i) {
+            linkTopic(i, records[i].topic);
+        }
+        for (int i = 0; i < timerCount; ++i) {
+            pMappedTimers[i].deadline = timers[i].deadline;
+            pMappedTimers[i].message = timers[i].message;
+        }
+        if (timerCount > 0) {
+            rebuildTimerWheel();
+        }
+        pMappedHeader->count = count;
+        pMappedHeader->tail = count % capacity;
+        FlushViewOfFile(pMappedHeader, 0);
+        header = *pMappedHeader;
         return true;
     }
     bool signalReady() {
@@ -284,17 +1035,24 @@ public:
             std::cerr << "Message too long: " << message.length() << " (max " << (MAX_MESSAGE_LENGTH - 1) << ")" << std::endl;
             return false;
         }
+        return write(Message(message), timeout);
+    }
+    bool write(const Message& message, DWORD timeout = INFINITE) {
+        if (message.is_empty || message.topic >= MAX_TOPICS) {
+            std::cerr << "Invalid message, topic: " << (int)message.topic << std::endl;
+            return false;
+        }
         DWORD waitResult = WaitForSingleObject(hSemEmpty, timeout);
         if (waitResult != WAIT_OBJECT_0) {
             if (waitResult == WAIT_TIMEOUT) {
-                std::cout << "Write timeout - queue full" << std::endl;
+                if (!quietTimeouts) std::cout << "Write timeout - queue full" << std::endl;
             }
             else {
                 std::cerr << "Failed to wait for empty semaphore: " << waitResult << std::endl;
             }
             return false;
         }
-        waitResult = WaitForSingleObject(hMutex, timeout);
+        waitResult = lockQueue(timeout);
         if (waitResult != WAIT_OBJECT_0) {
             std::cerr << "Failed to wait for mutex: " << waitResult << std::endl;
             ReleaseSemaphore(hSemEmpty, 1, NULL);
@@ -306,16 +1064,11 @@ public:
             ReleaseSemaphore(hSemEmpty, 1, NULL);
             return false;
         }
-        int tail = pMappedHeader->tail;
-        if (!pMappedMessages[tail].is_empty) {
-            std::cerr << "ERROR: Cell at tail " << tail << " is not empty!" << std::endl;
+        if (!enqueueLocked(stampChecksum(message))) {
             ReleaseMutex(hMutex);
             ReleaseSemaphore(hSemEmpty, 1, NULL);
             return false;
         }
-        pMappedMessages[tail] = Message(message);
-        pMappedHeader->tail = (tail + 1) % pMappedHeader->capacity;
-        pMappedHeader->count++;
         FlushViewOfFile(pMappedHeader, 0);
         header = *pMappedHeader;
         ReleaseMutex(hMutex);
@@ -326,24 +1079,81 @@ public:
         std::cout << "Message written successfully. New count: " << pMappedHeader->count << ", tail: " << pMappedHeader->tail << std::endl;
         return true;
     }
+    bool writeAt(const std::string& message, std::chrono::system_clock::time_point deadline, DWORD timeout = INFINITE) {
+        if (message.length() > MAX_MESSAGE_LENGTH - 1) {
+            std::cerr << "Message too long: " << message.length() << " (max " << (MAX_MESSAGE_LENGTH - 1) << ")" << std::endl;
+            return false;
+        }
+        return writeAt(Message(message), deadline, timeout);
+    }
+    bool writeAt(const Message& message, std::chrono::system_clock::time_point deadline, DWORD timeout = INFINITE) {
+        if (message.is_empty || message.topic >= MAX_TOPICS) {
+            std::cerr << "Invalid message, topic: " << (int)message.topic << std::endl;
+            return false;
+        }
+        DWORD waitResult = lockQueue(timeout);
+        if (waitResult != WAIT_OBJECT_0) {
+            std::cerr << "Failed to wait for mutex: " << waitResult << std::endl;
+            return false;
+        }
+        TimerWheel* w = pMappedWheel;
+        advanceTimers(currentTimeMs());
+        int node = w->freeList;
+        if (node == TIMER_NONE) {
+            std::cerr << "Timer wheel is full: " << w->pending << " pending timers" << std::endl;
+            ReleaseMutex(hMutex);
+            return false;
+        }
+        w->freeList = pMappedTimers[node].next;
+        pMappedTimers[node].deadline = std::chrono::duration_cast<std::chrono::milliseconds>(deadline.time_since_epoch()).count();
+        pMappedTimers[node].message = stampChecksum(message);
+        w->pending++;
+        long long previousDue = w->nextDue;
+        scheduleTimer(node);
+        w->nextDue = nextTimerEvent();
+        promoteDueTimers();
+        FlushViewOfFile(pMappedHeader, 0);
+        bool earlier = w->nextDue < previousDue;
+        if (earlier) w->wakeGeneration++;
+        if (earlier && pMappedTopics->wanted != 0) {
+            wakeTopicReadersLocked();
+        }
+        int pending = w->pending;
+        ReleaseMutex(hMutex);
+        if (earlier && !SetEvent(hTimerEvent)) {
+            std::cerr << "Failed to signal timer event: " << GetLastError() << std::endl;
+        }
+        std::cout << "Message scheduled successfully. Pending timers: " << pending << std::endl;
+        return true;
+    }
+    bool writeAfter(const std::string& message, DWORD delay, DWORD timeout = INFINITE) {
+        return writeAt(message, std::chrono::system_clock::now() + std::chrono::milliseconds(delay), timeout);
+    }
+    bool writeAfter(const Message& message, DWORD delay, DWORD timeout = INFINITE) {
+        return writeAt(message, std::chrono::system_clock::now() + std::chrono::milliseconds(delay), timeout);
+    }
     Message read(DWORD timeout = INFINITE) {
         Message emptyMsg;
-        DWORD waitResult = WaitForSingleObject(hSemFull, timeout);
+        DWORD waitResult = waitForMessage(timeout);
         if (waitResult != WAIT_OBJECT_0) {
             if (waitResult == WAIT_TIMEOUT) {
-                std::cout << "Read timeout - no messages available" << std::endl;
+                if (!quietTimeouts) std::cout << "Read timeout - no messages available" << std::endl;
             }
             else {
                 std::cerr << "Failed to wait for full semaphore: " << waitResult << std::endl;
             }
             return emptyMsg;
         }
-        waitResult = WaitForSingleObject(hMutex, timeout);
+        waitResult = lockQueue(timeout);
         if (waitResult != WAIT_OBJECT_0) {
             std::cerr << "Failed to wait for mutex: " << waitResult << std::endl;
             ReleaseSemaphore(hSemFull, 1, NULL);
             return emptyMsg;
         }
+        if (pMappedHeader->count > 0 && isTombstone(pMappedMessages[pMappedHeader->head])) {
+            std::cerr << "Consumed slot left at head position " << pMappedHeader->head << ", skipping it" << std::endl;
+            releaseConsumedSlotsLocked();
+        }
         if (pMappedHeader->count <= 0) {
             std::cout << "Queue is empty, but full semaphore was signaled" << std::endl;
             ReleaseMutex(hMutex);
@@ -351,24 +1161,165 @@ public:
             return emptyMsg;
         }
         int head = pMappedHeader->head;
-        Message msg = pMappedMessages[head];
+        Message msg = takeLocked(head);
+        FlushViewOfFile(pMappedHeader, 0);
+        header = *pMappedHeader;
+        ReleaseMutex(hMutex);
         if (msg.is_empty) {
-            std::cout << "Read empty message from position " << head << std::endl;
-            ReleaseMutex(hMutex);
-            ReleaseSemaphore(hSemFull, 1, NULL);
             return emptyMsg;
         }
-        pMappedMessages[head] = Message();
-        pMappedHeader->head = (head + 1) % pMappedHeader->capacity;
-        pMappedHeader->count--;
+        std::cout << "Message read successfully: " << msg.toString() << ", count: " << pMappedHeader->count << ", head: " << pMappedHeader->head << std::endl;
+        return msg;
+    }
+    Message read(TopicMask topics, DWORD timeout) {
+        if (topics == ALL_TOPICS) return read(timeout);
+        Message emptyMsg;
+        ULONGLONG start = GetTickCount64();
+        bool haveToken = false;
+        while (true) {
+            DWORD untilDue = pumpTimers();
+            DWORD remaining = timeout;
+            if (timeout != INFINITE) {
+                ULONGLONG elapsed = GetTickCount64() - start;
+                remaining = elapsed >= timeout ? 0 : (DWORD)(timeout - elapsed);
+            }
+            DWORD waitResult = lockQueue(remaining);
+            if (waitResult != WAIT_OBJECT_0) {
+                std::cerr << "Failed to wait for mutex: " << waitResult << std::endl;
+                if (haveToken) ReleaseSemaphore(hSemFull, 1, NULL);
+                break;
+            }
+            int slot = findFirstMatchLocked(topics);
+            while (slot != TOPIC_NONE && pMappedMessages[slot].is_empty) {
+                std::cerr << "Dropping stale topic entry for empty slot " << slot << std::endl;
+                if (unlinkTopicLocked(slot, 0) == TOPIC_NONE) break;
+                slot = findFirstMatchLocked(topics);
+            }
+            if (slot != TOPIC_NONE && pMappedMessages[slot].is_empty) slot = TOPIC_NONE;
+            if (slot != TOPIC_NONE && (haveToken || WaitForSingleObject(hSemFull, 0) == WAIT_OBJECT_0)) {
+                Message msg = takeLocked(slot);
+                FlushViewOfFile(pMappedHeader, 0);
+                header = *pMappedHeader;
+                ReleaseMutex(hMutex);
+                if (msg.is_empty) {
+                    return emptyMsg;
+                }
+                std::cout << "Message read successfully: " << msg.toString() << ", topic: " << (int)msg.topic << ", count: " << pMappedHeader->count << std::endl;
+                return msg;
+            }
+            if (haveToken) {
+                ReleaseSemaphore(hSemFull, 1, NULL);
+                haveToken = false;
+            }
+            if (remaining == 0) {
+                ReleaseMutex(hMutex);
+                break;
+            }
+            DWORD slice = untilDue < remaining ? untilDue : remaining;
+            if (slot != TOPIC_NONE) {
+                ReleaseMutex(hMutex);
+                waitResult = WaitForSingleObject(hSemFull, slice);
+                if (waitResult == WAIT_OBJECT_0) haveToken = true;
+                else if (waitResult != WAIT_TIMEOUT) {
+                    std::cerr << "Failed to wait for full semaphore: " << waitResult << std::endl;
+                    return emptyMsg;
+                }
+                continue;
+            }
+            pMappedTopics->wanted |= topics;
+            ResetEvent(hPublishEvent);
+            waitResult = SignalObjectAndWait(hMutex, hPublishEvent, slice, FALSE);
+            if (waitResult != WAIT_OBJECT_0 && waitResult != WAIT_TIMEOUT) {
+                std::cerr << "Failed to wait for publish event: " << waitResult << std::endl;
+                return emptyMsg;
+            }
+        }
+        if (!quietTimeouts) std::cout << "Read timeout - no messages available for topics" << std::endl;
+        return emptyMsg;
+    }
+    int writeBatch(const std::vector<Message>& messages, DWORD timeout = INFINITE) {
+        if (messages.empty()) return 0;
+        for (const Message& message : messages) {
+            if (message.is_empty || message.topic >= MAX_TOPICS) {
+                std::cerr << "Invalid message in batch, topic: " << (int)message.topic << std::endl;
+                return 0;
+            }
+        }
+        DWORD waitResult = WaitForSingleObject(hSemEmpty, timeout);
+        if (waitResult != WAIT_OBJECT_0) {
+            if (waitResult == WAIT_TIMEOUT) {
+                if (!quietTimeouts) std::cout << "Write timeout - queue full" << std::endl;
+            }
+            else {
+                std::cerr << "Failed to wait for empty semaphore: " << waitResult << std::endl;
+            }
+            return 0;
+        }
+        int reserved = 1;
+        while (reserved < (int)messages.size() && WaitForSingleObject(hSemEmpty, 0) == WAIT_OBJECT_0) reserved++;
+        waitResult = lockQueue(timeout);
+        if (waitResult != WAIT_OBJECT_0) {
+            std::cerr << "Failed to wait for mutex: " << waitResult << std::endl;
+            ReleaseSemaphore(hSemEmpty, reserved, NULL);
+            return 0;
+        }
+        int written = 0;
+        while (written < reserved && enqueueLocked(stampChecksum(messages[written]))) written++;
         FlushViewOfFile(pMappedHeader, 0);
         header = *pMappedHeader;
         ReleaseMutex(hMutex);
-        if (!ReleaseSemaphore(hSemEmpty, 1, NULL)) {
-            std::cerr << "Failed to release empty semaphore: " << GetLastError() << std::endl;
+        if (written < reserved) {
+            ReleaseSemaphore(hSemEmpty, reserved - written, NULL);
         }
-        std::cout << "Message read successfully: " << msg.toString() << ", count: " << pMappedHeader->count << ", head: " << pMappedHeader->head << std::endl;
-        return msg;
+        if (written > 0 && !ReleaseSemaphore(hSemFull, written, NULL)) {
+            std::cerr << "Failed to release full semaphore: " << GetLastError() << std::endl;
+        }
+        std::cout << "Batch written: " << written << " of " << messages.size() << " messages, count: " << pMappedHeader->count << std::endl;
+        return written;
+    }
+    std::vector<Message> readBatch(int maxCount, DWORD timeout = INFINITE) {
+        std::vector<Message> batch;
+        if (maxCount <= 0) return batch;
+        DWORD waitResult = waitForMessage(timeout);
+        if (waitResult != WAIT_OBJECT_0) {
+            if (waitResult == WAIT_TIMEOUT) {
+                if (!quietTimeouts) std::cout << "Read timeout - no messages available" << std::endl;
+            }
+            else {
+                std::cerr << "Failed to wait for full semaphore: " << waitResult << std::endl;
+            }
+            return batch;
+        }
+        int reserved = 1;
+        while (reserved < maxCount && WaitForSingleObject(hSemFull, 0) == WAIT_OBJECT_0) reserved++;
+        waitResult = lockQueue(timeout);
+        if (waitResult != WAIT_OBJECT_0) {
+            std::cerr << "Failed to wait for mutex: " << waitResult << std::endl;
+            ReleaseSemaphore(hSemFull, reserved, NULL);
+            return batch;
+        }
+        int taken = 0;
+        while (taken < reserved && pMappedHeader->count > 0) {
+            int head = pMappedHeader->head;
+            if (isTombstone(pMappedMessages[head])) {
+                std::cerr << "Consumed slot left at head position " << head << ", skipping it" << std::endl;
+                releaseConsumedSlotsLocked();
+                continue;
+            }
+            Message msg = takeLocked(head);
+            taken++;
+            if (!msg.is_empty) {
+                batch.push_back(msg);
+            }
+        }
+        FlushViewOfFile(pMappedHeader, 0);
+        header = *pMappedHeader;
+        ReleaseMutex(hMutex);
+        if (taken < reserved) {
+            ReleaseSemaphore(hSemFull, reserved - taken, NULL);
+        }
+        std::cout << "Batch read: " << batch.size() << " messages, count: " << pMappedHeader->count << std::endl;
+        return batch;
     }
     bool isEmpty() const {
         return pMappedHeader->count == 0;
@@ -382,6 +1333,76 @@ public:
     int getCount() const {
         return pMappedHeader->count;
     }
+    QueueHeader getHeader() const {
+        return *pMappedHeader;
+    }
+    int getHead() const {
+        return pMappedHeader->head;
+    }
+    int getTail() const {
+        return pMappedHeader->tail;
+    }
+    int getTimerCapacity() const {
+        return pMappedHeader->timerCapacity;
+    }
+    int getFlags() const {
+        return pMappedHeader->flags;
+    }
+    bool isHeaderValid() const {
+        return headerValid;
+    }
+    void setQuietTimeouts(bool quiet) {
+        quietTimeouts = quiet;
+    }
+    int getVisibleCount() const {
+        return header.count;
+    }
+    int getVisibleSlot(int position) const {
+        return header.capacity > 0 ? (header.head + position) % header.capacity : 0;
+    }
+    const Message& peek(int position) const {
+        return pMappedMessages[getVisibleSlot(position)];
+    }
+    bool isIntact(const Message& msg) const {
+        return checksumOk(msg);
+    }
+    std::vector<Message> snapshot() const {
+        int count = header.count;
+        int head = header.head;
+        int first = count < header.capacity - head ? count : header.capacity - head;
+        std::vector<Message> records(count);
+        if (first > 0) memcpy(records.data(), pMappedMessages + head, (size_t)first * sizeof(Message));
+        if (count > first) memcpy(records.data() + first, pMappedMessages, (size_t)(count - first) * sizeof(Message));
+        auto consumed = [](const Message& msg) { return msg.is_empty; };
+        records.erase(std::remove_if(records.begin(), records.end(), consumed), records.end());
+        return records;
+    }
+    std::vector<TimerNode> snapshotTimers() const {
+        std::vector<TimerNode> timers;
+        if (pMappedWheel == NULL) return timers;
+        for (int node = 0; node < header.timerCapacity; ++node) {
+            if (!pMappedTimers[node].message.is_empty) {
+                timers.push_back(pMappedTimers[node]);
+            }
+        }
+        return timers;
+    }
+    int getPendingTimers() const {
+        return pMappedWheel != NULL ? pMappedWheel->pending : 0;
+    }
+    bool hasChecksums() const {
+        return (pMappedHeader->flags & QUEUE_FLAG_CHECKSUMS) != 0;
+    }
+    int getCorruptCount() const {
+        return pMappedHeader->corrupt;
+    }
+    int getScrubErrors() const {
+        return scrubErrors;
+    }
+    TopicStats getTopicStats(unsigned char topic) const {
+        const TopicIndex& index = pMappedTopics->topics[topic % MAX_TOPICS];
+        return { index.written, index.read, index.pending };
+    }
 };
 
 #endif
@@ -1,6 +1,12 @@
 #include <gtest/gtest.h>
 #include <filesystem>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <vector>
 #include "message_queue.h"
+#include "rpc.h"
 
 namespace fs = std::filesystem;
 
@@ -24,7 +30,7 @@ TEST_F(MessageQueueTest, CreateQueue) {
     MessageQueue queue;
     EXPECT_TRUE(queue.create(test_filename, 5));
     auto file_size = fs::file_size(test_filename);
-    EXPECT_EQ(file_size, sizeof(QueueHeader) + 5 * sizeof(Message));
+    EXPECT_EQ(file_size, sizeof(QueueHeader) + 5 * sizeof(Message) + sizeof(TimerWheel) + DEFAULT_TIMER_CAPACITY * sizeof(TimerNode) + sizeof(TopicTable) + 5 * sizeof(int));
 }
 
 TEST_F(MessageQueueTest, WriteAndReadSingleMessage) {
@@ -105,3 +111,594 @@ TEST_F(MessageQueueTest, IsEmptyAndIsFull) {
     EXPECT_FALSE(queue.isEmpty());
     EXPECT_FALSE(queue.isFull());
 }
+
+TEST_F(MessageQueueTest, DelayedMessageNotVisibleUntilDue) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 3));
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(queue.writeAfter("Later", 200));
+    EXPECT_EQ(queue.getPendingTimers(), 1);
+    EXPECT_TRUE(queue.read(50).is_empty);
+    EXPECT_EQ(queue.read(2000).toString(), "Later");
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(190));
+    EXPECT_EQ(queue.getPendingTimers(), 0);
+}
+
+TEST_F(MessageQueueTest, PastDeadlineIsReadableImmediately) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 3));
+    EXPECT_TRUE(queue.writeAt("Now", std::chrono::system_clock::now() - std::chrono::seconds(1)));
+    EXPECT_EQ(queue.getCount(), 1);
+    EXPECT_EQ(queue.read(0).toString(), "Now");
+}
+
+TEST_F(MessageQueueTest, DelayedMessagesOrderedByDeadline) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 3));
+    queue.writeAfter("Third", 300);
+    queue.writeAfter("First", 20);
+    queue.writeAfter("Second", 100);
+    EXPECT_EQ(queue.read(2000).toString(), "First");
+    EXPECT_EQ(queue.read(2000).toString(), "Second");
+    EXPECT_EQ(queue.read(2000).toString(), "Third");
+}
+
+TEST_F(MessageQueueTest, DelayedMessageDoesNotTakeQueueSlot) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 1));
+    EXPECT_TRUE(queue.write("Now"));
+    EXPECT_TRUE(queue.writeAfter("Later", 10));
+    EXPECT_EQ(queue.read(2000).toString(), "Now");
+    EXPECT_EQ(queue.read(2000).toString(), "Later");
+}
+
+TEST_F(MessageQueueTest, TimerWheelFull) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 2, 1));
+    EXPECT_TRUE(queue.writeAfter("One", 10000));
+    EXPECT_FALSE(queue.writeAfter("Two", 10000));
+    EXPECT_EQ(queue.getPendingTimers(), 1);
+}
+
+TEST_F(MessageQueueTest, FarDeadlineStaysPending) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 2));
+    EXPECT_TRUE(queue.writeAt("Tomorrow", std::chrono::system_clock::now() + std::chrono::hours(24)));
+    EXPECT_TRUE(queue.read(50).is_empty);
+    EXPECT_EQ(queue.getPendingTimers(), 1);
+}
+
+TEST_F(MessageQueueTest, ScheduledMessageWakesEachBlockedReader) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 2, 4));
+    std::string shortWait = "unset";
+    std::string longWait;
+    std::thread shortReader([&] { shortWait = queue.read(100).toString(); });
+    std::thread longReader([&] { longWait = queue.read(3000).toString(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(queue.writeAfter("Later", 200));
+    shortReader.join();
+    longReader.join();
+    EXPECT_EQ(shortWait, "");
+    EXPECT_EQ(longWait, "Later");
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(1000));
+    EXPECT_EQ(queue.getPendingTimers(), 0);
+}
+
+TEST_F(MessageQueueTest, TimersSharedThroughQueueFile) {
+    MessageQueue writer;
+    ASSERT_TRUE(writer.create(test_filename, 2));
+    EXPECT_TRUE(writer.writeAfter("Shared", 100));
+    MessageQueue reader;
+    ASSERT_TRUE(reader.open(test_filename));
+    EXPECT_EQ(reader.getPendingTimers(), 1);
+    EXPECT_EQ(reader.read(2000).toString(), "Shared");
+}
+
+TEST_F(MessageQueueTest, TopicFilteredRead) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 4));
+    queue.write(Message("A1", 1));
+    queue.write(Message("B1", 2));
+    queue.write(Message("A2", 1));
+    queue.write(Message("C1", 3));
+    EXPECT_EQ(queue.read(1ULL << 2, 0).toString(), "B1");
+    EXPECT_EQ(queue.read((1ULL << 3) | (1ULL << 2), 0).toString(), "C1");
+    EXPECT_TRUE(queue.read(1ULL << 5, 0).is_empty);
+    EXPECT_EQ(queue.read().toString(), "A1");
+    EXPECT_EQ(queue.read().toString(), "A2");
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+TEST_F(MessageQueueTest, TopicReadFreesSlotsOnceHeadPasses) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 2));
+    queue.write(Message("A", 1));
+    queue.write(Message("B", 2));
+    EXPECT_EQ(queue.read(1ULL << 2, 0).toString(), "B");
+    EXPECT_FALSE(queue.write(Message("C", 2), 0));
+    EXPECT_EQ(queue.read(1ULL << 1, 0).toString(), "A");
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_TRUE(queue.write(Message("C", 2), 0));
+    EXPECT_TRUE(queue.write(Message("D", 1), 0));
+    EXPECT_EQ(queue.read(1ULL << 1, 0).toString(), "D");
+    EXPECT_EQ(queue.read(1ULL << 2, 0).toString(), "C");
+}
+
+TEST_F(MessageQueueTest, TopicReadWaitsForPublish) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 3));
+    queue.write(Message("Other", 1));
+    EXPECT_TRUE(queue.writeAfter(Message("Wanted", 4), 50));
+    EXPECT_EQ(queue.read(1ULL << 4, 2000).toString(), "Wanted");
+    EXPECT_EQ(queue.read().toString(), "Other");
+}
+
+TEST_F(MessageQueueTest, PublishWakesEachWaitingTopicReader) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 4));
+    std::string first;
+    std::string second;
+    std::thread firstReader([&] { first = queue.read(1ULL << 1, 5000).toString(); });
+    std::thread secondReader([&] { second = queue.read(1ULL << 2, 5000).toString(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto start = std::chrono::steady_clock::now();
+    queue.write(Message("Two", 2));
+    queue.write(Message("One", 1));
+    firstReader.join();
+    secondReader.join();
+    EXPECT_EQ(first, "One");
+    EXPECT_EQ(second, "Two");
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(1000));
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+TEST_F(MessageQueueTest, TopicStats) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 3));
+    queue.write(Message("A", 7));
+    queue.write(Message("B", 7));
+    queue.write(Message("C", 8));
+    queue.read(1ULL << 7, 0);
+    TopicStats stats = queue.getTopicStats(7);
+    EXPECT_EQ(stats.written, 2);
+    EXPECT_EQ(stats.read, 1);
+    EXPECT_EQ(stats.pending, 1);
+    EXPECT_EQ(queue.getTopicStats(8).pending, 1);
+    EXPECT_EQ(queue.getTopicStats(9).written, 0);
+}
+
+TEST(Crc32cTest, KnownVector) {
+    EXPECT_EQ(crc32c("123456789", 9), 0xE3069283u);
+    EXPECT_EQ(crc32cSoftware("123456789", 9), 0xE3069283u);
+    EXPECT_EQ(crc32c("", 0), 0u);
+}
+
+TEST(Crc32cTest, HardwareMatchesSoftware) {
+    std::vector<unsigned char> data(1000);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = (unsigned char)(i * 131 + 7);
+    for (size_t length = 0; length < 64; ++length) {
+        EXPECT_EQ(crc32c(data.data() + 3, length), crc32cSoftware(data.data() + 3, length));
+    }
+    EXPECT_EQ(crc32c(data.data(), data.size()), crc32cSoftware(data.data(), data.size()));
+    EXPECT_EQ(crc32c(data.data() + 500, 500, crc32c(data.data(), 500)), crc32c(data.data(), data.size()));
+}
+
+TEST_F(MessageQueueTest, ChecksumDetectsCorruptionOnRead) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 3, DEFAULT_TIMER_CAPACITY, QUEUE_FLAG_CHECKSUMS));
+    EXPECT_TRUE(queue.hasChecksums());
+    queue.write("Good");
+    queue.write("Bad");
+    queue.write("Fine");
+    {
+        std::fstream file(test_filename, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(sizeof(QueueHeader) + sizeof(Message) + offsetof(Message, text));
+        file.put('X');
+    }
+    EXPECT_EQ(queue.read(0).toString(), "Good");
+    EXPECT_TRUE(queue.read(0).is_empty);
+    EXPECT_EQ(queue.getCorruptCount(), 1);
+    EXPECT_EQ(queue.read(0).toString(), "Fine");
+}
+
+TEST_F(MessageQueueTest, CorruptTopicByteDoesNotDamageTopicIndex) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 3, DEFAULT_TIMER_CAPACITY, QUEUE_FLAG_CHECKSUMS));
+    queue.write(Message("A", 1));
+    queue.write(Message("B", 1));
+    queue.write(Message("C", 2));
+    {
+        std::fstream file(test_filename, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(sizeof(QueueHeader) + offsetof(Message, topic));
+        file.put(5);
+    }
+    EXPECT_TRUE(queue.read(0).is_empty);
+    EXPECT_EQ(queue.getCorruptCount(), 1);
+    EXPECT_EQ(queue.getTopicStats(1).pending, 1);
+    EXPECT_EQ(queue.getTopicStats(5).pending, 0);
+    EXPECT_EQ(queue.read(1ULL << 1, 0).toString(), "B");
+    EXPECT_EQ(queue.read(1ULL << 2, 0).toString(), "C");
+    EXPECT_EQ(queue.getCorruptCount(), 1);
+    EXPECT_TRUE(queue.isEmpty());
+}
+
+TEST_F(MessageQueueTest, OpenScrubReportsCorruptRecords) {
+    MessageQueue owner;
+    ASSERT_TRUE(owner.create(test_filename, 4, DEFAULT_TIMER_CAPACITY, QUEUE_FLAG_CHECKSUMS));
+    owner.write("One");
+    owner.write("Two");
+    owner.writeAfter("Timer", 100000);
+    {
+        std::fstream file(test_filename, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(sizeof(QueueHeader) + offsetof(Message, text) + 1);
+        file.put('#');
+    }
+    MessageQueue queue;
+    ASSERT_TRUE(queue.open(test_filename));
+    EXPECT_EQ(queue.getScrubErrors(), 1);
+}
+
+TEST_F(MessageQueueTest, OpenRecoversFlippedEmptyFlag) {
+    MessageQueue owner;
+    ASSERT_TRUE(owner.create(test_filename, 4, DEFAULT_TIMER_CAPACITY, QUEUE_FLAG_CHECKSUMS));
+    owner.write("One");
+    owner.write("Two");
+    {
+        std::fstream file(test_filename, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(sizeof(QueueHeader) + offsetof(Message, is_empty));
+        file.put(1);
+    }
+    MessageQueue queue;
+    ASSERT_TRUE(queue.open(test_filename));
+    EXPECT_EQ(queue.getScrubErrors(), 1);
+    EXPECT_EQ(queue.read(0).toString(), "One");
+    EXPECT_EQ(queue.read(0).toString(), "Two");
+}
+
+TEST_F(MessageQueueTest, OpenRebuildsDamagedTopicIndex) {
+    MessageQueue owner;
+    ASSERT_TRUE(owner.create(test_filename, 4));
+    owner.write(Message("A", 1));
+    {
+        std::fstream file(test_filename, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(MessageQueue::timerWheelOffset(4) + sizeof(TimerWheel) + DEFAULT_TIMER_CAPACITY * sizeof(TimerNode) + offsetof(TopicTable, topics) + sizeof(TopicIndex) + offsetof(TopicIndex, last));
+        int last = 100000000;
+        file.write((const char*)&last, sizeof(last));
+    }
+    MessageQueue queue;
+    ASSERT_TRUE(queue.open(test_filename));
+    EXPECT_EQ(queue.getScrubErrors(), 1);
+    EXPECT_TRUE(queue.write(Message("B", 1), 0));
+    EXPECT_EQ(queue.read(1ULL << 1, 0).toString(), "A");
+    EXPECT_EQ(queue.read(1ULL << 1, 0).toString(), "B");
+}
+
+TEST_F(MessageQueueTest, OpenRebuildsDamagedTimerWheel) {
+    MessageQueue owner;
+    ASSERT_TRUE(owner.create(test_filename, 4, 8));
+    owner.writeAfter("Later", 100000);
+    {
+        std::fstream file(test_filename, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(MessageQueue::timerWheelOffset(4) + offsetof(TimerWheel, freeList));
+        int freeList = 100000000;
+        file.write((const char*)&freeList, sizeof(freeList));
+    }
+    MessageQueue queue;
+    ASSERT_TRUE(queue.open(test_filename));
+    EXPECT_EQ(queue.getScrubErrors(), 1);
+    EXPECT_EQ(queue.getPendingTimers(), 1);
+    EXPECT_TRUE(queue.writeAfter("Now", 0));
+    EXPECT_EQ(queue.read(1000).toString(), "Now");
+    EXPECT_EQ(queue.getPendingTimers(), 1);
+}
+
+TEST_F(MessageQueueTest, OpenRejectsInconsistentHeader) {
+    MessageQueue owner;
+    ASSERT_TRUE(owner.create(test_filename, 4));
+    owner.write("One");
+    {
+        std::fstream file(test_filename, std::ios::in | std::ios::out | std::ios::binary);
+        QueueHeader corrupted = { 4, 3, 0, 1, DEFAULT_TIMER_CAPACITY, 0, 0 };
+        file.write((const char*)&corrupted, sizeof(corrupted));
+    }
+    MessageQueue queue;
+    EXPECT_FALSE(queue.open(test_filename));
+}
+
+TEST_F(MessageQueueTest, WriteAndReadBatch) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 3));
+    std::vector<Message> batch = { Message("One"), Message("Two"), Message("Three"), Message("Four") };
+    EXPECT_EQ(queue.writeBatch(batch, 0), 3);
+    EXPECT_TRUE(queue.isFull());
+    std::vector<Message> read = queue.readBatch(2, 0);
+    ASSERT_EQ(read.size(), 2u);
+    EXPECT_EQ(read[0].toString(), "One");
+    EXPECT_EQ(read[1].toString(), "Two");
+    read = queue.readBatch(10, 0);
+    ASSERT_EQ(read.size(), 1u);
+    EXPECT_EQ(read[0].toString(), "Three");
+    EXPECT_TRUE(queue.readBatch(10, 0).empty());
+}
+
+TEST_F(MessageQueueTest, ReadOnlySnapshotSkipsConsumedRecords) {
+    MessageQueue queue;
+    ASSERT_TRUE(queue.create(test_filename, 4));
+    queue.write(Message("One", 0));
+    queue.write(Message("Two", 1));
+    queue.write(Message("Three", 0));
+    EXPECT_EQ(queue.read(1ULL << 1, 0).toString(), "Two");
+    MessageQueue inspector;
+    ASSERT_TRUE(inspector.openReadOnly(test_filename));
+    EXPECT_EQ(inspector.getCount(), 3);
+    EXPECT_TRUE(inspector.peek(1).is_empty);
+    std::vector<Message> records = inspector.snapshot();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].toString(), "One");
+    EXPECT_EQ(records[1].toString(), "Three");
+    EXPECT_EQ(queue.read().toString(), "One");
+}
+
+TEST_F(MessageQueueTest, ReadOnlyOpenClampsInconsistentHeader) {
+    MessageQueue owner;
+    ASSERT_TRUE(owner.create(test_filename, 4));
+    owner.write("One");
+    owner.write("Two");
+    {
+        std::fstream file(test_filename, std::ios::in | std::ios::out | std::ios::binary);
+        QueueHeader crashed = { 4, 3, 0, 2, DEFAULT_TIMER_CAPACITY, 0, 0 };
+        file.write((const char*)&crashed, sizeof(crashed));
+    }
+    MessageQueue inspector;
+    ASSERT_TRUE(inspector.openReadOnly(test_filename));
+    EXPECT_FALSE(inspector.isHeaderValid());
+    EXPECT_EQ(inspector.getCount(), 3);
+    EXPECT_EQ(inspector.getVisibleCount(), 3);
+    std::vector<Message> records = inspector.snapshot();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[1].toString(), "Two");
+    {
+        std::fstream file(test_filename, std::ios::in | std::ios::out | std::ios::binary);
+        QueueHeader garbage = { 1000000, 7, 999, 2, DEFAULT_TIMER_CAPACITY, 0, 0 };
+        file.write((const char*)&garbage, sizeof(garbage));
+    }
+    MessageQueue damaged;
+    ASSERT_TRUE(damaged.openReadOnly(test_filename));
+    EXPECT_FALSE(damaged.isHeaderValid());
+    EXPECT_EQ(damaged.getVisibleCount(), 4);
+    EXPECT_EQ(damaged.getVisibleSlot(0), 0);
+    EXPECT_EQ(damaged.getPendingTimers(), 0);
+    EXPECT_EQ(damaged.peek(1).toString(), "Two");
+}
+
+TEST_F(MessageQueueTest, ImportFileRestoresBacklog) {
+    std::vector<Message> records = { Message("One", 0), Message("Two", 2), Message("Three", 0) };
+    MessageQueue imported;
+    ASSERT_TRUE(imported.importFile(test_filename, records.data(), (int)records.size(), 5, 16, 0));
+    MessageQueue existing;
+    EXPECT_FALSE(existing.importFile(test_filename, records.data(), (int)records.size(), 5, 16, 0));
+    MessageQueue queue;
+    ASSERT_TRUE(queue.attach(test_filename));
+    EXPECT_EQ(queue.getCount(), 3);
+    EXPECT_FALSE(queue.hasChecksums());
+    EXPECT_EQ(queue.getTopicStats(2).pending, 1);
+    EXPECT_EQ(queue.read(1ULL << 2, 0).toString(), "Two");
+    EXPECT_EQ(queue.read().toString(), "One");
+    EXPECT_EQ(queue.read().toString(), "Three");
+    EXPECT_TRUE(queue.write("Four", 0));
+}
+
+TEST_F(MessageQueueTest, ImportFileReschedulesTimers) {
+    std::vector<Message> records = { Message("Ready", 0) };
+    long long now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    std::vector<TimerNode> timers(2);
+    timers[0].deadline = now + 200;
+    timers[0].message = Message("Later", 0);
+    timers[1].deadline = now - 1000;
+    timers[1].message = Message("Overdue", 0);
+    MessageQueue imported;
+    ASSERT_TRUE(imported.importFile(test_filename, records.data(), (int)records.size(), 4, 4, 0, timers.data(), (int)timers.size()));
+    MessageQueue queue;
+    ASSERT_TRUE(queue.attach(test_filename));
+    EXPECT_EQ(queue.getPendingTimers(), 2);
+    EXPECT_EQ(queue.snapshotTimers().size(), 2u);
+    EXPECT_EQ(queue.read(0).toString(), "Ready");
+    EXPECT_EQ(queue.read(0).toString(), "Overdue");
+    EXPECT_EQ(queue.read(2000).toString(), "Later");
+    EXPECT_EQ(queue.getPendingTimers(), 0);
+    EXPECT_TRUE(queue.snapshotTimers().empty());
+}
+
+TEST_F(MessageQueueTest, AttachRejectsQueueInUse) {
+    MessageQueue owner;
+    ASSERT_TRUE(owner.create(test_filename, 3));
+    owner.write("One");
+    MessageQueue queue;
+    EXPECT_FALSE(queue.attach(test_filename));
+    EXPECT_EQ(owner.read(0).toString(), "One");
+    EXPECT_TRUE(owner.isEmpty());
+}
+
+class RpcTest : public MessageQueueTest {
+protected:
+    void TearDown() override {
+        for (unsigned short id : { 1, 2 }) {
+            std::string reply = rpcReplyQueueName(test_filename, id);
+            if (fs::exists(reply)) {
+                fs::remove(reply);
+            }
+        }
+        MessageQueueTest::TearDown();
+    }
+};
+
+TEST_F(RpcTest, CallReturnsReply) {
+    RpcServer server;
+    ASSERT_TRUE(server.create(test_filename, 8));
+    server.handle(1, [](const Message& request) { return "echo:" + request.toString(); });
+    std::atomic<bool> running(true);
+    std::thread serverThread([&] { server.run(running); });
+    RpcClient client;
+    ASSERT_TRUE(client.connect(test_filename, 1, 8));
+    Message reply = client.call("ping", 2000, 1).get();
+    running = false;
+    serverThread.join();
+    EXPECT_FALSE(reply.is_empty);
+    EXPECT_EQ(reply.toString(), "echo:ping");
+}
+
+TEST_F(RpcTest, PipelinedCallsMatchByCorrelationId) {
+    RpcServer server;
+    ASSERT_TRUE(server.create(test_filename, 16));
+    server.handle(0, [](const Message& request) { return std::to_string(std::stoi(request.toString()) * 2); });
+    std::atomic<bool> running(true);
+    std::thread serverThread([&] { server.run(running); });
+    RpcClient first;
+    RpcClient second;
+    ASSERT_TRUE(first.connect(test_filename, 1, 16));
+    ASSERT_TRUE(second.connect(test_filename, 2, 16));
+    std::vector<std::future<Message>> calls;
+    for (int i = 0; i < 100; ++i) {
+        calls.push_back((i % 2 == 0 ? first : second).call(std::to_string(i), 5000));
+    }
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(calls[i].get().toString(), std::to_string(i * 2));
+    }
+    running = false;
+    serverThread.join();
+}
+
+TEST_F(RpcTest, ConcurrentCallsOnOneClient) {
+    RpcServer server;
+    ASSERT_TRUE(server.create(test_filename, 16));
+    server.handle(0, [](const Message& request) { return request.toString(); });
+    std::atomic<bool> running(true);
+    std::thread serverThread([&] { server.run(running); });
+    RpcClient client;
+    ASSERT_TRUE(client.connect(test_filename, 1, 16));
+    std::atomic<int> matched(0);
+    std::vector<std::thread> callers;
+    for (int t = 0; t < 4; ++t) {
+        callers.emplace_back([&, t] {
+            for (int i = 0; i < 25; ++i) {
+                std::string text = std::to_string(t * 100 + i);
+                if (client.call(text, 5000).get().toString() == text) matched++;
+            }
+        });
+    }
+    for (std::thread& caller : callers) caller.join();
+    EXPECT_EQ(matched, 100);
+    running = false;
+    serverThread.join();
+}
+
+TEST_F(RpcTest, BlockedCallDoesNotDelayShorterTimeout) {
+    RpcServer server;
+    ASSERT_TRUE(server.create(test_filename, 1));
+    RpcClient client;
+    ASSERT_TRUE(client.connect(test_filename, 1, 4));
+    std::future<Message> queued = client.call("queued", 5000);
+    std::future<Message> blocked;
+    std::thread caller([&] { blocked = client.call("blocked", 1500); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(client.call("short", 100).get().is_empty);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(700));
+    caller.join();
+    EXPECT_TRUE(blocked.get().is_empty);
+}
+
+TEST_F(RpcTest, ReplyStatusFlagsUnknownMethodAndLongResult) {
+    RpcServer server;
+    ASSERT_TRUE(server.create(test_filename, 8));
+    server.handle(0, [](const Message&) { return std::string(); });
+    server.handle(1, [](const Message&) { return std::string(40, 'x'); });
+    std::atomic<bool> running(true);
+    std::thread serverThread([&] { server.run(running); });
+    RpcClient client;
+    ASSERT_TRUE(client.connect(test_filename, 1, 8));
+    Message empty = client.call("ok", 5000, 0).get();
+    Message tooLong = client.call("long", 5000, 1).get();
+    Message unknown = client.call("what", 5000, 9).get();
+    EXPECT_FALSE(empty.is_empty);
+    EXPECT_EQ(empty.status, RPC_STATUS_OK);
+    EXPECT_EQ(tooLong.status, RPC_STATUS_REPLY_TOO_LONG);
+    EXPECT_EQ(tooLong.toString(), "");
+    EXPECT_EQ(unknown.status, RPC_STATUS_UNKNOWN_METHOD);
+    running = false;
+    serverThread.join();
+}
+
+TEST_F(RpcTest, StalledClientDoesNotBlockOtherReplies) {
+    RpcServer server;
+    ASSERT_TRUE(server.create(test_filename, 16));
+    server.handle(0, [](const Message& request) { return request.toString(); });
+    MessageQueue stalledReplies;
+    ASSERT_TRUE(stalledReplies.create(rpcReplyQueueName(test_filename, 1), 1, 0));
+    MessageQueue requests;
+    ASSERT_TRUE(requests.open(test_filename));
+    for (unsigned int i = 1; i <= 3; ++i) {
+        Message request("stuck");
+        request.correlation_id = i;
+        request.reply_to = 1;
+        ASSERT_TRUE(requests.write(request, 0));
+    }
+    RpcClient client;
+    ASSERT_TRUE(client.connect(test_filename, 2, 4));
+    std::future<Message> reply = client.call("fast", 5000);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(server.poll(0), 4);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(1000));
+    EXPECT_EQ(reply.get().toString(), "fast");
+    EXPECT_EQ(server.getBacklog(), 2);
+    EXPECT_EQ(stalledReplies.read(0).correlation_id, 1u);
+    server.poll(0);
+    EXPECT_EQ(server.getBacklog(), 1);
+}
+
+TEST_F(RpcTest, ReconnectReusesReplyQueueHeldByServer) {
+    RpcServer server;
+    ASSERT_TRUE(server.create(test_filename, 8));
+    server.handle(0, [](const Message& request) { return request.toString(); });
+    {
+        RpcClient first;
+        ASSERT_TRUE(first.connect(test_filename, 1, 1));
+        std::future<Message> hello = first.call("hello", 2000);
+        EXPECT_EQ(server.poll(0), 1);
+        EXPECT_EQ(hello.get().toString(), "hello");
+        EXPECT_TRUE(first.call("lost", 50).get().is_empty);
+    }
+    EXPECT_EQ(server.poll(0), 1);
+    RpcClient second;
+    ASSERT_TRUE(second.connect(test_filename, 1, 1));
+    std::future<Message> reply = second.call("again", 2000);
+    EXPECT_EQ(server.poll(0), 1);
+    EXPECT_EQ(reply.get().toString(), "again");
+    EXPECT_EQ(server.getBacklog(), 0);
+}
+
+TEST_F(RpcTest, IdlePollingDoesNotLog) {
+    RpcServer server;
+    ASSERT_TRUE(server.create(test_filename, 4));
+    RpcClient client;
+    ASSERT_TRUE(client.connect(test_filename, 1, 4));
+    std::ostringstream captured;
+    std::streambuf* original = std::cout.rdbuf(captured.rdbuf());
+    for (int i = 0; i < 4; ++i) {
+        server.poll(RPC_POLL_INTERVAL);
+    }
+    std::cout.rdbuf(original);
+    EXPECT_EQ(captured.str().find("timeout"), std::string::npos);
+}
+
+TEST_F(RpcTest, CallTimesOutWithoutServer) {
+    RpcServer server;
+    ASSERT_TRUE(server.create(test_filename, 4));
+    RpcClient client;
+    ASSERT_TRUE(client.connect(test_filename, 1, 4));
+    std::future<Message> reply = client.call("lost", 100);
+    EXPECT_TRUE(reply.get().is_empty);
+    EXPECT_EQ(client.getPendingCalls(), 0);
+}
@@ -0,0 +1,237 @@
+#include "message_queue.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <windows.h>
+
+#pragma pack(push, 1)
+struct QueueStreamHeader {
+    char magic[4];
+    int version;
+    int flags;
+    int count;
+    int recordSize;
+    int capacity;
+    int timerCapacity;
+    int timerCount;
+};
+#pragma pack(pop)
+
+constexpr char QUEUE_STREAM_MAGIC[4] = { 'M', 'Q', 'S', '1' };
+constexpr int QUEUE_STREAM_VERSION = 2;
+
+class MqTool {
+private:
+    std::ostream& out_;
+    static std::string jsonEscape(const std::string& text) {
+        std::ostringstream escaped;
+        for (unsigned char c : text) {
+            if (c == '"' || c == '\\') escaped << '\\' << c;
+            else if (c < 0x20) escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+            else escaped << c;
+        }
+        return escaped.str();
+    }
+    static std::string hexBytes(const void* data, size_t length) {
+        std::ostringstream hex;
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < length; ++i) {
+            hex << std::hex << std::setw(2) << std::setfill('0') << (int)bytes[i];
+            if (i + 1 < length) hex << ' ';
+        }
+        return hex.str();
+    }
+    void dumpText(const MessageQueue& queue) {
+        out_ << "Capacity: " << queue.getCapacity() << std::endl;
+        out_ << "Count: " << queue.getCount() << std::endl;
+        out_ << "Head: " << queue.getHead() << std::endl;
+        out_ << "Tail: " << queue.getTail() << std::endl;
+        out_ << "Timer capacity: " << queue.getTimerCapacity() << std::endl;
+        out_ << "Pending timers: " << queue.getPendingTimers() << std::endl;
+        out_ << "Checksums: " << (queue.hasChecksums() ? "Yes" : "No") << std::endl;
+        out_ << "Corrupted messages dropped: " << queue.getCorruptCount() << std::endl;
+        if (!queue.isHeaderValid()) {
+            out_ << "Header: inconsistent, showing " << queue.getVisibleCount() << " slots starting at slot " << queue.getVisibleSlot(0) << std::endl;
+        }
+        for (int i = 0; i < queue.getVisibleCount(); ++i) {
+            const Message& msg = queue.peek(i);
+            int slot = queue.getVisibleSlot(i);
+            out_ << "[" << slot << "] ";
+            if (msg.is_empty) {
+                out_ << "(consumed)" << std::endl;
+                continue;
+            }
+            out_ << "topic " << (int)msg.topic << ", correlation " << msg.correlation_id << ", reply to " << msg.reply_to << ", status " << (int)msg.status << ": \"" << msg.toString() << "\"";
+            if (!queue.isIntact(msg)) out_ << " (checksum mismatch)";
+            out_ << std::endl;
+        }
+    }
+    void dumpHex(const MessageQueue& queue) {
+        QueueHeader queueHeader = queue.getHeader();
+        out_ << "  header  " << hexBytes(&queueHeader, sizeof(queueHeader)) << std::endl;
+        for (int i = 0; i < queue.getVisibleCount(); ++i) {
+            int slot = queue.getVisibleSlot(i);
+            out_ << std::setw(8) << std::setfill(' ') << slot << "  " << hexBytes(&queue.peek(i), sizeof(Message)) << std::endl;
+        }
+    }
+    void dumpJson(const MessageQueue& queue) {
+        out_ << "{" << std::endl;
+        out_ << "  \"capacity\": " << queue.getCapacity() << "," << std::endl;
+        out_ << "  \"count\": " << queue.getCount() << "," << std::endl;
+        out_ << "  \"head\": " << queue.getHead() << "," << std::endl;
+        out_ << "  \"tail\": " << queue.getTail() << "," << std::endl;
+        out_ << "  \"timerCapacity\": " << queue.getTimerCapacity() << "," << std::endl;
+        out_ << "  \"pendingTimers\": " << queue.getPendingTimers() << "," << std::endl;
+        out_ << "  \"checksums\": " << (queue.hasChecksums() ? "true" : "false") << "," << std::endl;
+        out_ << "  \"corrupt\": " << queue.getCorruptCount() << "," << std::endl;
+        out_ << "  \"headerValid\": " << (queue.isHeaderValid() ? "true" : "false") << "," << std::endl;
+        out_ << "  \"messages\": [";
+        for (int i = 0; i < queue.getVisibleCount(); ++i) {
+            const Message& msg = queue.peek(i);
+            int slot = queue.getVisibleSlot(i);
+            out_ << (i == 0 ? "" : ",") << std::endl << "    { \"slot\": " << slot;
+            if (msg.is_empty) {
+                out_ << ", \"consumed\": true }";
+                continue;
+            }
+            out_ << ", \"topic\": " << (int)msg.topic << ", \"correlationId\": " << msg.correlation_id << ", \"replyTo\": " << msg.reply_to << ", \"status\": " << (int)msg.status;
+            out_ << ", \"intact\": " << (queue.isIntact(msg) ? "true" : "false") << ", \"text\": \"" << jsonEscape(msg.toString()) << "\" }";
+        }
+        out_ << std::endl << "  ]" << std::endl << "}" << std::endl;
+    }
+public:
+    MqTool(std::ostream& out) : out_(out) {}
+    bool dump(const std::string& queueFile, const std::string& format) {
+        MessageQueue queue;
+        if (!queue.openReadOnly(queueFile)) {
+            std::cerr << "Error: cannot map queue file " << queueFile << std::endl;
+            return false;
+        }
+        if (format == "text") dumpText(queue);
+        else if (format == "hex") dumpHex(queue);
+        else if (format == "json") dumpJson(queue);
+        else {
+            std::cerr << "Error: unknown format '" << format << "' (use text, hex or json)" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    bool exportStream(const std::string& queueFile, const std::string& streamFile) {
+        MessageQueue queue;
+        if (!queue.openReadOnly(queueFile)) {
+            std::cerr << "Error: cannot map queue file " << queueFile << std::endl;
+            return false;
+        }
+        std::vector<Message> records = queue.snapshot();
+        std::vector<TimerNode> timers = queue.snapshotTimers();
+        QueueStreamHeader streamHeader;
+        memcpy(streamHeader.magic, QUEUE_STREAM_MAGIC, sizeof(streamHeader.magic));
+        streamHeader.version = QUEUE_STREAM_VERSION;
+        streamHeader.flags = queue.getFlags();
+        streamHeader.count = (int)records.size();
+        streamHeader.recordSize = sizeof(Message);
+        streamHeader.capacity = queue.isHeaderValid() ? queue.getCapacity() : 0;
+        streamHeader.timerCapacity = queue.isHeaderValid() ? queue.getTimerCapacity() : DEFAULT_TIMER_CAPACITY;
+        streamHeader.timerCount = (int)timers.size();
+        HANDLE hFile = CreateFileA(streamFile.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hFile == INVALID_HANDLE_VALUE) {
+            std::cerr << "CreateFile failed: " << GetLastError() << std::endl;
+            return false;
+        }
+        DWORD written = 0;
+        DWORD recordBytes = (DWORD)(records.size() * sizeof(Message));
+        DWORD timerBytes = (DWORD)(timers.size() * sizeof(TimerNode));
+        bool ok = WriteFile(hFile, &streamHeader, sizeof(streamHeader), &written, NULL) && written == sizeof(streamHeader);
+        if (ok && recordBytes > 0) {
+            ok = WriteFile(hFile, records.data(), recordBytes, &written, NULL) && written == recordBytes;
+        }
+        if (ok && timerBytes > 0) {
+            ok = WriteFile(hFile, timers.data(), timerBytes, &written, NULL) && written == timerBytes;
+        }
+        CloseHandle(hFile);
+        if (!ok) {
+            std::cerr << "WriteFile failed: " << GetLastError() << std::endl;
+            return false;
+        }
+        out_ << "Exported " << records.size() << " messages and " << timers.size() << " pending timers to " << streamFile << std::endl;
+        return true;
+    }
+    bool importStream(const std::string& streamFile, const std::string& queueFile, int capacity, int timerCapacity) {
+        HANDLE hFile = CreateFileA(streamFile.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hFile == INVALID_HANDLE_VALUE) {
+            std::cerr << "CreateFile failed: " << GetLastError() << std::endl;
+            return false;
+        }
+        QueueStreamHeader streamHeader;
+        DWORD got = 0;
+        if (!ReadFile(hFile, &streamHeader, sizeof(streamHeader), &got, NULL) || got != sizeof(streamHeader) ||
+            memcmp(streamHeader.magic, QUEUE_STREAM_MAGIC, sizeof(streamHeader.magic)) != 0 ||
+            streamHeader.version != QUEUE_STREAM_VERSION || streamHeader.recordSize != (int)sizeof(Message) || streamHeader.count < 0 ||
+            streamHeader.capacity < 0 || streamHeader.timerCapacity < 0 || streamHeader.timerCount < 0) {
+            std::cerr << "Error: " << streamFile << " is not a queue stream" << std::endl;
+            CloseHandle(hFile);
+            return false;
+        }
+        LARGE_INTEGER streamSize;
+        long long recordBytesTotal = (long long)streamHeader.count * streamHeader.recordSize;
+        long long timerBytesTotal = (long long)streamHeader.timerCount * (long long)sizeof(TimerNode);
+        if (!GetFileSizeEx(hFile, &streamSize) || streamSize.QuadPart - (long long)sizeof(streamHeader) != recordBytesTotal + timerBytesTotal ||
+            recordBytesTotal > (long long)MAXDWORD || timerBytesTotal > (long long)MAXDWORD) {
+            std::cerr << "Error: stream " << streamFile << " size does not match its header (" << streamHeader.count << " records, " << streamHeader.timerCount << " timers)" << std::endl;
+            CloseHandle(hFile);
+            return false;
+        }
+        std::vector<Message> records(streamHeader.count);
+        DWORD recordBytes = (DWORD)(records.size() * sizeof(Message));
+        std::vector<TimerNode> timers(streamHeader.timerCount);
+        DWORD timerBytes = (DWORD)(timers.size() * sizeof(TimerNode));
+        bool ok = recordBytes == 0 || (ReadFile(hFile, records.data(), recordBytes, &got, NULL) && got == recordBytes);
+        ok = ok && (timerBytes == 0 || (ReadFile(hFile, timers.data(), timerBytes, &got, NULL) && got == timerBytes));
+        CloseHandle(hFile);
+        if (!ok) {
+            std::cerr << "Error: stream " << streamFile << " is truncated" << std::endl;
+            return false;
+        }
+        if (capacity <= 0) capacity = streamHeader.capacity;
+        if (capacity < streamHeader.count) capacity = streamHeader.count;
+        if (capacity <= 0) capacity = 1;
+        if (timerCapacity < 0) timerCapacity = streamHeader.timerCapacity;
+        if (timerCapacity < streamHeader.timerCount) timerCapacity = streamHeader.timerCount;
+        MessageQueue queue;
+        if (!queue.importFile(queueFile, records.data(), streamHeader.count, capacity, timerCapacity, streamHeader.flags, timers.data(), streamHeader.timerCount)) {
+            std::cerr << "Error: cannot import into " << queueFile << std::endl;
+            return false;
+        }
+        out_ << "Imported " << streamHeader.count << " messages and " << streamHeader.timerCount << " pending timers into " << queueFile << " (capacity " << capacity << ", timer capacity " << timerCapacity << ")" << std::endl;
+        return true;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    std::ostream out(std::cout.rdbuf());
+    std::cout.rdbuf(nullptr);
+    std::string command = argc > 1 ? argv[1] : "";
+    MqTool tool(out);
+    bool ok;
+    if (command == "dump" && (argc == 3 || argc == 4)) {
+        ok = tool.dump(argv[2], argc == 4 ? argv[3] : "text");
+    }
+    else if (command == "export" && argc == 4) {
+        ok = tool.exportStream(argv[2], argv[3]);
+    }
+    else if (command == "import" && argc >= 4 && argc <= 6) {
+        int capacity = argc > 4 ? std::atoi(argv[4]) : 0;
+        int timerCapacity = argc > 5 ? std::atoi(argv[5]) : -1;
+        ok = tool.importStream(argv[2], argv[3], capacity, timerCapacity);
+    }
+    else {
+        std::cerr << "Usage:" << std::endl;
+        std::cerr << "  " << argv[0] << " dump <queue file> [text|hex|json]" << std::endl;
+        std::cerr << "  " << argv[0] << " export <queue file> <stream file>" << std::endl;
+        std::cerr << "  " << argv[0] << " import <stream file> <new queue file> [capacity] [timer capacity]" << std::endl;
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -27,18 +27,36 @@ private:
     bool setup() {
         std::cout << "Enter binary filename: ";
         std::cin >> filename_;
+        if (!openQueue()) return false;
+        std::cout << "Enter number of Sender processes: ";
+        std::cin >> sender_count_;
+        return true;
+    }
+    bool openQueue() {
+        if (fs::exists(filename_)) {
+            char answer;
+            std::cout << "File already exists. Attach to the queue stored in it? (y/n): ";
+            std::cin >> answer;
+            if (answer == 'y' || answer == 'Y') {
+                if (!queue_.attach(filename_)) {
+                    std::cerr << "Error attaching to file" << std::endl;
+                    return false;
+                }
+                capacity_ = queue_.getCapacity();
+                std::cout << "Attached to queue with capacity " << capacity_ << " and " << queue_.getCount() << " stored messages" << std::endl;
+                return true;
+            }
+        }
         std::cout << "Enter queue capacity: ";
         std::cin >> capacity_;
         if (capacity_ <= 0) {
             std::cerr << "Error: capacity must be > 0" << std::endl;
             return false;
         }
-        if (!queue_.create(filename_, capacity_)) {
+        if (!queue_.create(filename_, capacity_, DEFAULT_TIMER_CAPACITY, QUEUE_FLAG_CHECKSUMS)) {
             std::cerr << "Error creating file" << std::endl;
             return false;
         }
-        std::cout << "Enter number of Sender processes: ";
-        std::cin >> sender_count_;
         return true;
     }
     bool startSenders() {
@@ -91,7 +109,7 @@ private:
         return true;
     }
     bool mainLoop() {
-        std::cout << "\nCommands:\n  r - read message\n  s - show status\n  q - quit\n" << std::endl;
+        std::cout << "\nCommands:\n  r - read message\n  t - read message of one topic\n  s - show status\n  q - quit\n" << std::endl;
         char command;
         while (true) {
             std::cout << "> ";
@@ -108,18 +126,41 @@ private:
                     std::cout << "Received: " << msg.toString() << std::endl;
                 }
             }
+            else if (command == 't') {
+                int topic;
+                std::cout << "Enter topic (0-" << (MAX_TOPICS - 1) << "): ";
+                std::cin >> topic;
+                if (topic < 0 || topic >= MAX_TOPICS) {
+                    std::cout << "Error: topic must be in range 0-" << (MAX_TOPICS - 1) << std::endl;
+                    continue;
+                }
+                Message msg = queue_.read(1ULL << topic, 1000);
+                if (msg.is_empty) {
+                    std::cout << "No messages for topic " << topic << " or timeout." << std::endl;
+                }
+                else {
+                    std::cout << "Received [" << topic << "]: " << msg.toString() << std::endl;
+                }
+            }
             else if (command == 's') {
                 std::cout << "Queue status:" << std::endl;
                 std::cout << "  Capacity: " << queue_.getCapacity() << std::endl;
                 std::cout << "  Count: " << queue_.getCount() << std::endl;
+                std::cout << "  Pending timers: " << queue_.getPendingTimers() << std::endl;
+                std::cout << "  Corrupted messages dropped: " << queue_.getCorruptCount() << std::endl;
                 std::cout << "  Is empty: " << (queue_.isEmpty() ? "Yes" : "No") << std::endl;
                 std::cout << "  Is full: " << (queue_.isFull() ? "Yes" : "No") << std::endl;
+                for (int topic = 0; topic < MAX_TOPICS; ++topic) {
+                    TopicStats stats = queue_.getTopicStats((unsigned char)topic);
+                    if (stats.written == 0) continue;
+                    std::cout << "  Topic " << topic << ": written " << stats.written << ", read " << stats.read << ", pending " << stats.pending << std::endl;
+                }
             }
             else if (command == 'q') {
                 break;
             }
             else {
-                std::cout << "Unknown command. Use 'r' to read, 's' for status, or 'q' to quit." << std::endl;
+                std::cout << "Unknown command. Use 'r' to read, 't' to read a topic, 's' for status, or 'q' to quit." << std::endl;
             }
         }
         cleanup();
@@ -0,0 +1,265 @@
+#ifndef RPC_H
+#define RPC_H
+
+#include "message_queue.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <filesystem>
+#include <windows.h>
+
+constexpr int RPC_BATCH_SIZE = 32;
+constexpr DWORD RPC_POLL_INTERVAL = 50;
+constexpr DWORD RPC_REPLY_TIMEOUT = 5000;
+constexpr int RPC_MAX_BACKLOG = 1024;
+constexpr unsigned char RPC_STATUS_OK = 0;
+constexpr unsigned char RPC_STATUS_UNKNOWN_METHOD = 1;
+constexpr unsigned char RPC_STATUS_REPLY_TOO_LONG = 2;
+
+inline std::string rpcReplyQueueName(const std::string& requestFile, unsigned short clientId) {
+    return requestFile + ".reply" + std::to_string(clientId);
+}
+
+class RpcClient {
+private:
+    struct PendingCall {
+        std::promise<Message> promise;
+        ULONGLONG deadline;
+    };
+    std::string requestFile_;
+    unsigned short clientId_;
+    MessageQueue requests_;
+    MessageQueue replies_;
+    std::mutex mutex_;
+    std::map<unsigned int, PendingCall> pending_;
+    unsigned int nextCorrelationId_;
+    std::atomic<bool> running_;
+    std::thread receiver_;
+public:
+    RpcClient() : clientId_(0), nextCorrelationId_(1), running_(false) {}
+    ~RpcClient() {
+        close();
+    }
+    bool connect(const std::string& requestFile, unsigned short clientId, int replyCapacity) {
+        requestFile_ = requestFile;
+        clientId_ = clientId;
+        std::string replyFile = rpcReplyQueueName(requestFile, clientId);
+        replies_.setQuietTimeouts(true);
+        if (std::filesystem::exists(replyFile) && replies_.open(replyFile)) {
+            int stale = 0;
+            std::vector<Message> batch = replies_.readBatch(RPC_BATCH_SIZE, 0);
+            while (!batch.empty()) {
+                stale += (int)batch.size();
+                batch = replies_.readBatch(RPC_BATCH_SIZE, 0);
+            }
+            nextCorrelationId_ = (unsigned int)GetTickCount64() | 1;
+            std::cout << "Reusing reply queue for client " << clientId << ", dropped " << stale << " stale replies" << std::endl;
+        }
+        else {
+            replies_.close();
+            if (!replies_.create(replyFile, replyCapacity, 0)) {
+                std::cerr << "Failed to create reply queue for client " << clientId << std::endl;
+                return false;
+            }
+        }
+        if (!requests_.open(requestFile)) {
+            std::cerr << "Failed to open request queue: " << requestFile << std::endl;
+            return false;
+        }
+        running_ = true;
+        receiver_ = std::thread(&RpcClient::receiveLoop, this);
+        return true;
+    }
+    std::future<Message> call(const std::string& request, DWORD timeout = INFINITE, unsigned char method = 0) {
+        Message message(request, method);
+        if (request.length() > MAX_MESSAGE_LENGTH - 1) {
+            std::cerr << "Request too long: " << request.length() << " (max " << (MAX_MESSAGE_LENGTH - 1) << ")" << std::endl;
+            message.is_empty = true;
+        }
+        return call(message, timeout);
+    }
+    std::future<Message> call(Message request, DWORD timeout = INFINITE) {
+        std::promise<Message> promise;
+        std::future<Message> result = promise.get_future();
+        if (!running_ || request.is_empty) {
+            promise.set_value(Message());
+            return result;
+        }
+        ULONGLONG start = GetTickCount64();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            request.correlation_id = nextCorrelationId_++;
+            request.reply_to = clientId_;
+            PendingCall& entry = pending_[request.correlation_id];
+            entry.promise = std::move(promise);
+            entry.deadline = timeout == INFINITE ? ULLONG_MAX : start + timeout;
+        }
+        if (!requests_.write(request, timeout)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = pending_.find(request.correlation_id);
+            if (it != pending_.end()) {
+                it->second.promise.set_value(Message());
+                pending_.erase(it);
+            }
+        }
+        return result;
+    }
+    void close() {
+        if (running_.exchange(false) && receiver_.joinable()) {
+            receiver_.join();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : pending_) {
+            entry.second.promise.set_value(Message());
+        }
+        pending_.clear();
+    }
+    int getPendingCalls() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return (int)pending_.size();
+    }
+private:
+    void receiveLoop() {
+        while (running_) {
+            std::vector<Message> batch = replies_.readBatch(RPC_BATCH_SIZE, RPC_POLL_INTERVAL);
+            ULONGLONG now = GetTickCount64();
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const Message& reply : batch) {
+                auto it = pending_.find(reply.correlation_id);
+                if (it == pending_.end()) {
+                    std::cout << "Dropping late reply " << reply.correlation_id << std::endl;
+                    continue;
+                }
+                it->second.promise.set_value(reply);
+                pending_.erase(it);
+            }
+            for (auto it = pending_.begin(); it != pending_.end();) {
+                if (it->second.deadline <= now) {
+                    std::cout << "Call " << it->first << " timed out" << std::endl;
+                    it->second.promise.set_value(Message());
+                    it = pending_.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+    }
+};
+
+class RpcServer {
+public:
+    typedef std::function<std::string(const Message&)> Handler;
+private:
+    struct ReplyChannel {
+        std::unique_ptr<MessageQueue> queue;
+        std::vector<Message> backlog;
+        ULONGLONG stalledSince;
+    };
+    std::string requestFile_;
+    MessageQueue requests_;
+    std::map<unsigned char, Handler> handlers_;
+    std::map<unsigned short, ReplyChannel> channels_;
+    ReplyChannel* replyChannel(unsigned short clientId) {
+        auto it = channels_.find(clientId);
+        if (it != channels_.end()) return &it->second;
+        std::unique_ptr<MessageQueue> queue(new MessageQueue());
+        if (!queue->open(rpcReplyQueueName(requestFile_, clientId))) {
+            std::cerr << "Failed to open reply queue for client " << clientId << std::endl;
+            return NULL;
+        }
+        queue->setQuietTimeouts(true);
+        ReplyChannel& channel = channels_[clientId];
+        channel.queue = std::move(queue);
+        channel.stalledSince = 0;
+        return &channel;
+    }
+    bool hasBacklog() const {
+        for (const auto& entry : channels_) {
+            if (!entry.second.backlog.empty()) return true;
+        }
+        return false;
+    }
+    void flushReplies() {
+        ULONGLONG now = GetTickCount64();
+        for (auto it = channels_.begin(); it != channels_.end();) {
+            ReplyChannel& channel = it->second;
+            int written = channel.backlog.empty() ? 0 : channel.queue->writeBatch(channel.backlog, 0);
+            channel.backlog.erase(channel.backlog.begin(), channel.backlog.begin() + written);
+            if (channel.backlog.empty() || written > 0) {
+                channel.stalledSince = 0;
+            }
+            else if (channel.stalledSince == 0) {
+                channel.stalledSince = now;
+            }
+            bool stalled = channel.stalledSince != 0 && now - channel.stalledSince >= RPC_REPLY_TIMEOUT;
+            if (stalled || (int)channel.backlog.size() > RPC_MAX_BACKLOG) {
+                std::cerr << "Dropping " << channel.backlog.size() << " replies and the reply queue for client " << it->first << std::endl;
+                it = channels_.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+public:
+    bool create(const std::string& requestFile, int capacity) {
+        requestFile_ = requestFile;
+        requests_.setQuietTimeouts(true);
+        return requests_.create(requestFile, capacity, 0);
+    }
+    void handle(unsigned char method, Handler handler) {
+        handlers_[method] = handler;
+    }
+    int poll(DWORD timeout) {
+        if (timeout > RPC_POLL_INTERVAL && hasBacklog()) timeout = RPC_POLL_INTERVAL;
+        std::vector<Message> batch = requests_.readBatch(RPC_BATCH_SIZE, timeout);
+        for (const Message& request : batch) {
+            auto it = handlers_.find(request.topic);
+            std::string text;
+            unsigned char status = RPC_STATUS_OK;
+            if (it == handlers_.end()) {
+                std::cerr << "No handler for method " << (int)request.topic << std::endl;
+                status = RPC_STATUS_UNKNOWN_METHOD;
+            }
+            else {
+                text = it->second(request);
+                if (text.length() > MAX_MESSAGE_LENGTH - 1) {
+                    std::cerr << "Reply too long for method " << (int)request.topic << ": " << text.length() << " (max " << (MAX_MESSAGE_LENGTH - 1) << ")" << std::endl;
+                    text.clear();
+                    status = RPC_STATUS_REPLY_TOO_LONG;
+                }
+            }
+            Message reply(text, request.topic);
+            reply.status = status;
+            reply.correlation_id = request.correlation_id;
+            reply.reply_to = request.reply_to;
+            ReplyChannel* channel = replyChannel(request.reply_to);
+            if (channel == NULL) {
+                std::cerr << "Dropping reply " << request.correlation_id << " for client " << request.reply_to << std::endl;
+                continue;
+            }
+            channel->backlog.push_back(reply);
+        }
+        flushReplies();
+        return (int)batch.size();
+    }
+    int getBacklog() const {
+        int total = 0;
+        for (const auto& entry : channels_) total += (int)entry.second.backlog.size();
+        return total;
+    }
+    void run(const std::atomic<bool>& running) {
+        while (running) {
+            poll(RPC_POLL_INTERVAL);
+        }
+    }
+};
+
+#endif
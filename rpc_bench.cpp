@@ -0,0 +1,106 @@
+#include "message_queue.h"
+#include "rpc.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <windows.h>
+
+namespace fs = std::filesystem;
+
+class RpcBenchmark {
+private:
+    int iterations_;
+    int inFlight_;
+    std::ostream& out_;
+    static double elapsedMicros(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+    void removeFiles(const std::vector<std::string>& files) {
+        for (const std::string& file : files) {
+            if (fs::exists(file)) fs::remove(file);
+        }
+    }
+public:
+    RpcBenchmark(int iterations, int inFlight, std::ostream& out) : iterations_(iterations), inFlight_(inFlight), out_(out) {}
+    double rawPingPong() {
+        MessageQueue ping;
+        MessageQueue pong;
+        if (!ping.create("bench_ping.bin", 16, 0) || !pong.create("bench_pong.bin", 16, 0)) return -1;
+        std::thread echo([this] {
+            MessageQueue in;
+            MessageQueue out;
+            if (!in.open("bench_ping.bin") || !out.open("bench_pong.bin")) return;
+            for (int i = 0; i < iterations_; ++i) {
+                out.write(in.read(5000), 5000);
+            }
+        });
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations_; ++i) {
+            ping.write("ping", 5000);
+            pong.read(5000);
+        }
+        double total = elapsedMicros(start);
+        echo.join();
+        removeFiles({ "bench_ping.bin", "bench_pong.bin" });
+        return total / iterations_;
+    }
+    double rpcRoundTrip(int depth) {
+        RpcServer server;
+        if (!server.create("bench_rpc.bin", 64)) return -1;
+        server.handle(0, [](const Message& request) { return request.toString(); });
+        std::atomic<bool> running(true);
+        std::thread serverThread([&] { server.run(running); });
+        double total;
+        {
+            RpcClient client;
+            if (!client.connect("bench_rpc.bin", 1, 64)) {
+                running = false;
+                serverThread.join();
+                return -1;
+            }
+            std::vector<std::future<Message>> calls;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations_; i += depth) {
+                calls.clear();
+                for (int j = 0; j < depth && i + j < iterations_; ++j) {
+                    calls.push_back(client.call("ping", 5000));
+                }
+                for (std::future<Message>& call : calls) {
+                    call.get();
+                }
+            }
+            total = elapsedMicros(start);
+        }
+        running = false;
+        serverThread.join();
+        removeFiles({ "bench_rpc.bin", rpcReplyQueueName("bench_rpc.bin", 1) });
+        return total / iterations_;
+    }
+    void run() {
+        std::streambuf* log = std::cout.rdbuf(nullptr);
+        double raw = rawPingPong();
+        double rpc = rpcRoundTrip(1);
+        double pipelined = rpcRoundTrip(inFlight_);
+        std::cout.rdbuf(log);
+        out_ << "Round trips: " << iterations_ << std::endl;
+        out_ << "  raw write()/read() ping-pong: " << raw << " us" << std::endl;
+        out_ << "  rpc call(), 1 in flight:      " << rpc << " us" << std::endl;
+        out_ << "  rpc call(), " << inFlight_ << " in flight:     " << pipelined << " us" << std::endl;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 10000;
+    int inFlight = argc > 2 ? std::atoi(argv[2]) : 32;
+    if (iterations <= 0 || inFlight <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [iterations] [in-flight calls]" << std::endl;
+        return 1;
+    }
+    RpcBenchmark benchmark(iterations, inFlight, std::cerr);
+    benchmark.run();
+    return 0;
+}
@@ -51,7 +51,7 @@ private:
         return true;
     }
     bool mainLoop() {
-        std::cout << "\n=== Sender Commands ===\n  s - send message\n  q - quit\n" << std::endl;
+        std::cout << "\n=== Sender Commands ===\n  s - send message\n  d - send delayed message\n  t - send message with topic\n  q - quit\n" << std::endl;
         char command;
         std::string message;
         while (true) {
@@ -74,12 +74,53 @@ private:
                     std::cout << "Successfully sent: \"" << message << "\"" << std::endl;
                 }
             }
+            else if (command == 'd') {
+                DWORD delay;
+                std::cout << "Enter delay in ms: ";
+                std::cin >> delay;
+                std::cout << "Enter message (max " << (MAX_MESSAGE_LENGTH - 1) << " chars): ";
+                std::cin.ignore();
+                std::getline(std::cin, message);
+                if (message.length() > MAX_MESSAGE_LENGTH - 1) {
+                    std::cout << "Error: Message too long (" << message.length() << " chars, max " << (MAX_MESSAGE_LENGTH - 1) << ")" << std::endl;
+                    continue;
+                }
+                if (!queue_.writeAfter(message, delay, 5000)) {
+                    std::cout << "Failed to schedule message." << std::endl;
+                }
+                else {
+                    std::cout << "Scheduled: \"" << message << "\" in " << delay << " ms" << std::endl;
+                }
+            }
+            else if (command == 't') {
+                int topic;
+                std::cout << "Enter topic (0-" << (MAX_TOPICS - 1) << "): ";
+                std::cin >> topic;
+                if (topic < 0 || topic >= MAX_TOPICS) {
+                    std::cout << "Error: topic must be in range 0-" << (MAX_TOPICS - 1) << std::endl;
+                    continue;
+                }
+                std::cout << "Enter message (max " << (MAX_MESSAGE_LENGTH - 1) << " chars): ";
+                std::cin.ignore();
+                std::getline(std::cin, message);
+                if (message.length() > MAX_MESSAGE_LENGTH - 1) {
+                    std::cout << "Error: Message too long (" << message.length() << " chars, max " << (MAX_MESSAGE_LENGTH - 1) << ")" << std::endl;
+                    continue;
+                }
+                if (!queue_.write(Message(message, (unsigned char)topic), 5000)) {
+                    std::cout << "Queue is full. Waiting 1 second..." << std::endl;
+                    std::this_thread::sleep_for(std::chrono::seconds(1));
+                }
+                else {
+                    std::cout << "Successfully sent [" << topic << "]: \"" << message << "\"" << std::endl;
+                }
+            }
             else if (command == 'q') {
                 std::cout << "Quitting sender..." << std::endl;
                 break;
             }
             else {
-                std::cout << "Unknown command. Use 's' to send or 'q' to quit." << std::endl;
+                std::cout << "Unknown command. Use 's' to send, 'd' to send delayed, 't' to send with topic or 'q' to quit." << std::endl;
             }
         }
         return true;